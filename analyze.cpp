@@ -0,0 +1,511 @@
+/****************************************************************************
+* Batch position analysis.
+*
+* Reads positions from files or stdin and writes the engine's best move,
+* score and principal variation for each as one JSON line. A line holding
+* a FEN, such as B:W18,24,K27:B12,16, is one position. Anything else is
+* read as PDN game records: tag pairs, with an optional [FEN "..."] start
+* position, then the moves, with each position of the game analyzed in
+* turn. A game ends at its result, such as 1-0 or *, or at the next tags.
+*
+* The positions are searched on a pool of worker threads, each with its
+* own Engine, and written in input order. Input is read only as fast as
+* the results are written, so memory stays bounded however long the input
+* is. Positions seen before are skipped, found by their hash in a fixed
+* size table.
+*
+* Options:
+*   --depth <plies>     Search depth (default 10 when no limit is given)
+*   --movetime <ms>     Time for each position
+*   --nodes <count>     Nodes for each position
+*   --workers <count>   Positions searched at once (default: hardware threads)
+*   --hash <MB>         Transposition table size for each worker
+*   --shared-hash <name> One transposition table for every worker, in the
+*                       named shared memory segment, shared with any other
+*                       analysis using the name
+*   --tablebase <path>  Endgame tablebase
+*   --weights <path>    Evaluation weights
+*   --dedup <count>     Positions remembered for skipping repeats, 0 to
+*                       analyze every position (default 1048576)
+*   --output <path>     File to write (default stdout)
+*   Other arguments are files to read, - for stdin (default stdin)
+****************************************************************************/
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "engine.h"
+#include "eval.h"
+
+// Positions read ahead of the output for each worker
+static const int WindowPerWorker = 8;
+
+struct TAnalyzeOptions {
+    TSearchLimits limits;
+    int workers;
+    TEngineConfig engine;
+    const char *tablebase;      // nullptr for none
+    const char *sharedHash;     // shared memory table name, nullptr for none
+    size_t dedupSize;
+};
+
+struct TAnalysisJob {
+    uint64_t id;
+    TBoard board;
+    int side;
+    char source[48];    // JSON members saying where the position came from
+};
+
+/****************************************************************************
+ * Positions waiting for a worker and results waiting to be written.
+ * Results are written in the order the positions were read, and the reader
+ * waits while window positions are unwritten.
+ */
+struct TPipeline {
+    FILE *output;
+    uint64_t window;
+    std::mutex mutex;                   // guards the fields below
+    std::condition_variable jobReady;
+    std::condition_variable spaceReady;
+    std::deque<TAnalysisJob> jobs;
+    bool finished;                      // no more jobs will come
+    uint64_t nextWrite;                 // id of the next result to write
+    std::vector<std::string> results;   // by id % window
+    std::vector<bool> ready;
+};
+
+/****************************************************************************
+ * Write a principal variation as PDN moves separated by spaces.
+ * @param result
+ * @return
+ */
+static std::string pvText(const TSearchResult &result)
+{
+    std::string text;
+    char move[MoveTextSize];
+
+    for (int idx = 0; idx < result.pvLength; idx++) {
+        moveToText(result.pv[idx], move);
+        if (idx > 0)
+            text += ' ';
+        text += move;
+    }
+    return text;
+}
+
+/****************************************************************************
+ * Search one position and format its JSON line.
+ */
+static std::string analyze(Engine &engine, const TSearchLimits &limits, const TAnalysisJob &job)
+{
+    Game game(job.board, job.side);
+    TSearchResult result;
+    char fen[FenTextSize];
+    char buf[FenTextSize + 256];
+
+    boardToFen(job.board, job.side, fen, sizeof(fen));
+    if (game.result() != GameOngoing) {
+        snprintf(buf, sizeof(buf), "{\"id\":%llu,%s,\"fen\":\"%s\",\"move\":null}",
+                 static_cast<unsigned long long>(job.id), job.source, fen);
+        return buf;
+    }
+    result = engine.think(game, limits);
+    std::string pv = pvText(result);
+    std::string move = pv.substr(0, pv.find(' '));
+    snprintf(buf, sizeof(buf), "{\"id\":%llu,%s,\"fen\":\"%s\",\"move\":\"%s\",\"score\":%d,\"depth\":%d,"
+                               "\"nodes\":%llu,\"time_ms\":%lld,\"pv\":\"",
+             static_cast<unsigned long long>(job.id), job.source, fen, move.c_str(), result.score, result.depth,
+             static_cast<unsigned long long>(result.nodes), static_cast<long long>(result.timeMs));
+    return buf + pv + "\"}";
+} // analyze
+
+/****************************************************************************
+ * Worker thread, analyzes positions until the input is done.
+ */
+static void worker(TPipeline &pipeline, const TAnalyzeOptions &options)
+{
+    Engine engine(options.engine);
+    if (options.tablebase)
+        engine.loadTablebase(options.tablebase);
+    if (options.sharedHash)
+        engine.shareTable(options.sharedHash);
+
+    for (;;) {
+        TAnalysisJob job;
+        {
+            std::unique_lock<std::mutex> lock(pipeline.mutex);
+            pipeline.jobReady.wait(lock, [&] { return pipeline.finished || !pipeline.jobs.empty(); });
+            if (pipeline.jobs.empty())
+                return;
+            job = pipeline.jobs.front();
+            pipeline.jobs.pop_front();
+        }
+        std::string line = analyze(engine, options.limits, job);
+
+        std::lock_guard<std::mutex> lock(pipeline.mutex);
+        size_t slot = job.id % pipeline.window;
+        pipeline.results[slot] = line;
+        pipeline.ready[slot] = true;
+        bool wrote = false;
+        for (slot = pipeline.nextWrite % pipeline.window; pipeline.ready[slot];
+             slot = pipeline.nextWrite % pipeline.window) {
+            pipeline.results[slot] += '\n';
+            fwrite(pipeline.results[slot].data(), 1, pipeline.results[slot].size(), pipeline.output);
+            pipeline.results[slot].clear();
+            pipeline.ready[slot] = false;
+            pipeline.nextWrite++;
+            wrote = true;
+        }
+        if (wrote) {
+            fflush(pipeline.output);
+            pipeline.spaceReady.notify_one();
+        }
+    }
+} // worker
+
+/****************************************************************************
+ * Turns input into positions to analyze. Keeps the state of the PDN game
+ * being read.
+ */
+class TReader {
+public:
+    TReader(TPipeline &pipeline, size_t dedupSize)
+            : positions(0), repeats(0), pipeline(pipeline), seen(dedupSize, 0), nextId(1), games(0), line(0)
+    {
+        endGame();
+    }
+
+    void readFile(FILE *file, const char *name);
+
+    void finish()
+    {
+        endGame();
+    }
+
+    uint64_t positions;     // positions read
+    uint64_t repeats;       // positions skipped as seen before
+
+private:
+    void submit(const TBoard &board, int side, const char *source);
+
+    void readToken(const std::string &token, const char *name);
+
+    void readTag(const char *text);
+
+    void startGame();
+
+    void endGame();
+
+    TPipeline &pipeline;
+    std::vector<uint64_t> seen;     // position keys, by key % size
+    uint64_t nextId;
+    int games;
+    int line;                       // of the current file
+
+    // The PDN game being read
+    TBoard start;                   // from its FEN tag, or the opening position
+    int startSide;
+    Game game;
+    int turns;                      // played in it
+    bool inGame;                    // its moves have begun
+    bool skipping;                  // it had an illegal move, skip to its end
+    int comment;                    // depth of {} and () being skipped
+};
+
+/****************************************************************************
+ * Queue a position unless it was seen before. Waits while the output is a
+ * full window behind.
+ */
+void TReader::submit(const TBoard &board, int side, const char *source)
+{
+    positions++;
+    if (!seen.empty()) {
+        uint64_t key = positionKey(board, side);
+        uint64_t &slot = seen[key % seen.size()];
+        if (slot == key) {
+            repeats++;
+            return;
+        }
+        slot = key;
+    }
+
+    TAnalysisJob job;
+    job.id = nextId++;
+    job.board = board;
+    job.side = side;
+    snprintf(job.source, sizeof(job.source), "%s", source);
+
+    std::unique_lock<std::mutex> lock(pipeline.mutex);
+    pipeline.spaceReady.wait(lock, [&] { return job.id - pipeline.nextWrite < pipeline.window; });
+    pipeline.jobs.push_back(job);
+    pipeline.jobReady.notify_one();
+}
+
+void TReader::startGame()
+{
+    char source[48];
+    games++;
+    game = Game(start, startSide);
+    turns = 0;
+    inGame = true;
+    snprintf(source, sizeof(source), "\"game\":%d,\"ply\":0", games);
+    submit(game.board(), game.sideToMove(), source);
+}
+
+void TReader::endGame()
+{
+    start = newBoard();
+    startSide = Black;
+    inGame = false;
+    skipping = false;
+    comment = 0;
+}
+
+/****************************************************************************
+ * Read a tag pair. Only the FEN tag matters, the others are skipped.
+ */
+void TReader::readTag(const char *text)
+{
+    if (inGame)
+        endGame();
+    if (strncmp(text, "[FEN \"", 6) != 0)
+        return;
+    std::string fen(text + 6);
+    fen = fen.substr(0, fen.find('"'));
+    if (!parseFen(fen.c_str(), start, startSide))
+        fprintf(stderr, "Invalid FEN tag at line %d\n", line);
+}
+
+/****************************************************************************
+ * Read one token of PDN movetext: a move number, a move, a result, or part
+ * of a comment or variation.
+ */
+void TReader::readToken(const std::string &token, const char *name)
+{
+    bool commented = comment > 0;
+    const char *p = token.c_str();
+    for (; *p; p++) {
+        if (*p == '{' || *p == '(') {
+            comment++;
+            commented = true;
+        } else if ((*p == '}' || *p == ')') && comment > 0) {
+            comment--;
+        }
+    }
+    if (commented)
+        return;
+
+    if (token == "1-0" || token == "0-1" || token == "2-0" || token == "0-2" || token == "1-1" ||
+        token == "1/2-1/2" || token == "*") {
+        if (!inGame)
+            startGame();
+        endGame();
+        return;
+    }
+    // Move numbers, "12." or "12...", may be joined to the move
+    p = token.c_str();
+    while (isdigit(static_cast<unsigned char>(*p)))
+        p++;
+    if (*p == '.') {
+        while (*p == '.')
+            p++;
+    } else {
+        p = token.c_str();
+    }
+    std::string move(p);
+    while (!move.empty() && (move.back() == '!' || move.back() == '?' || move.back() == '*'))
+        move.pop_back();
+    if (move.empty() || move[0] == '$')
+        return; // number or annotation
+
+    if (!inGame)
+        startGame();
+    if (skipping)
+        return;
+    if (!game.playText(move.c_str())) {
+        fprintf(stderr, "%s:%d: illegal move %s in game %d, skipping the rest of the game\n", name, line,
+                move.c_str(), games);
+        skipping = true;
+        return;
+    }
+    char source[48];
+    snprintf(source, sizeof(source), "\"game\":%d,\"ply\":%d", games, ++turns);
+    submit(game.board(), game.sideToMove(), source);
+} // readToken
+
+/****************************************************************************
+ * Read every position in a file.
+ * @param file
+ * @param name - For messages
+ */
+void TReader::readFile(FILE *file, const char *name)
+{
+    char buf[4096];
+    std::string text;
+
+    line = 0;
+    while (fgets(buf, sizeof(buf), file)) {
+        text = buf;
+        // A line longer than the buffer
+        while (!text.empty() && text.back() != '\n' && fgets(buf, sizeof(buf), file))
+            text += buf;
+        line++;
+
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos)
+            continue;
+        const char *p = text.c_str() + first;
+        if (comment == 0 && (*p == 'B' || *p == 'W') && p[1] == ':') {
+            endGame();
+            TBoard board;
+            int side;
+            std::string fen(p);
+            fen.erase(fen.find_last_not_of(" \t\r\n") + 1);
+            if (!parseFen(fen.c_str(), board, side)) {
+                fprintf(stderr, "%s:%d: invalid FEN\n", name, line);
+                continue;
+            }
+            char source[48];
+            snprintf(source, sizeof(source), "\"line\":%d", line);
+            submit(board, side, source);
+        } else if (comment == 0 && *p == '[') {
+            readTag(p);
+        } else {
+            std::string token;
+            for (; *p; p++) {
+                if (isspace(static_cast<unsigned char>(*p))) {
+                    if (!token.empty())
+                        readToken(token, name);
+                    token.clear();
+                } else {
+                    token += *p;
+                }
+            }
+            if (!token.empty())
+                readToken(token, name);
+        }
+    }
+} // readFile
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--depth plies] [--movetime ms] [--nodes count] [--workers count] [--hash MB]\n"
+                    "       [--shared-hash name] [--tablebase path] [--weights path] [--dedup count] [--output path] [file ...]\n", program);
+}
+
+int main(int argc, char *argv[])
+{
+    TAnalyzeOptions options = {{0, 0, 0, nullptr}, static_cast<int>(std::thread::hardware_concurrency()),
+                               DefaultEngineConfig, nullptr, nullptr, 1u << 20};
+    const char *output = nullptr;
+    const char *weights = nullptr;
+    std::vector<const char *> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            inputs.push_back(argv[i]);
+        } else if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        } else if (strcmp(argv[i], "--depth") == 0) {
+            options.limits.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--movetime") == 0) {
+            options.limits.timeMs = strtoll(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--nodes") == 0) {
+            options.limits.nodes = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--workers") == 0) {
+            options.workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--hash") == 0) {
+            options.engine.hashMegabytes = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--shared-hash") == 0) {
+            options.sharedHash = argv[++i];
+        } else if (strcmp(argv[i], "--tablebase") == 0) {
+            options.tablebase = argv[++i];
+        } else if (strcmp(argv[i], "--weights") == 0) {
+            weights = argv[++i];
+        } else if (strcmp(argv[i], "--dedup") == 0) {
+            options.dedupSize = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--output") == 0) {
+            output = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.workers < 1)
+        options.workers = 1;
+    if (weights && !loadEvalWeights(weights)) {
+        fprintf(stderr, "Can't read evaluation weights %s\n", weights);
+        return 1;
+    }
+    if (options.sharedHash) {
+        // Make the segment now, so the workers all find it
+        TTranspositionTable table(0);
+        if (!table.openShared(options.sharedHash, options.engine.hashMegabytes, TAmerican::VariantId)) {
+            fprintf(stderr, "Can't open shared hash %s\n", options.sharedHash);
+            return 1;
+        }
+    }
+    if (!options.limits.depth && !options.limits.timeMs && !options.limits.nodes)
+        options.limits.depth = 10;
+    if (inputs.empty())
+        inputs.push_back("-");
+
+    TPipeline pipeline;
+    pipeline.output = output ? fopen(output, "w") : stdout;
+    if (!pipeline.output) {
+        perror(output);
+        return 1;
+    }
+    pipeline.window = static_cast<uint64_t>(options.workers) * WindowPerWorker;
+    pipeline.finished = false;
+    pipeline.nextWrite = 1;
+    pipeline.results.resize(pipeline.window);
+    pipeline.ready.resize(pipeline.window, false);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int id = 0; id < options.workers; id++)
+        workers.emplace_back(worker, std::ref(pipeline), std::cref(options));
+
+    TReader reader(pipeline, options.dedupSize);
+    int status = 0;
+    for (const char *input : inputs) {
+        bool isStdin = strcmp(input, "-") == 0;
+        FILE *file = isStdin ? stdin : fopen(input, "r");
+        if (!file) {
+            perror(input);
+            status = 1;
+            continue;
+        }
+        reader.readFile(file, isStdin ? "stdin" : input);
+        reader.finish();
+        if (!isStdin)
+            fclose(file);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pipeline.mutex);
+        pipeline.finished = true;
+    }
+    pipeline.jobReady.notify_all();
+    for (std::thread &t : workers)
+        t.join();
+    if (output && fclose(pipeline.output) != 0) {
+        perror(output);
+        status = 1;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    fprintf(stderr, "%llu positions, %llu repeats skipped, %llu analyzed in %.2fs\n",
+            static_cast<unsigned long long>(reader.positions), static_cast<unsigned long long>(reader.repeats),
+            static_cast<unsigned long long>(reader.positions - reader.repeats), elapsed.count());
+    return status;
+} // main
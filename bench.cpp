@@ -0,0 +1,354 @@
+/****************************************************************************
+* Microbenchmarks for the engine hot paths.
+*
+* Each benchmark runs over a fixed corpus of opening, middlegame and endgame
+* positions and writes one JSON line with the time and heap allocations per
+* operation. The search benchmark searches each position to a fixed depth
+* on one thread, so its node count only changes when the search does.
+* A smaller corpus of international draughts positions times the 10x10
+* move generator and search. The 10x10 search branches more, so it runs 4
+* plies shallower than the 8x8 one, and at least 1 ply.
+*
+* Options:
+*   --iterations <count>  Passes over the corpus for each benchmark
+*                         (default 200000)
+*   --depth <plies>       Search depth for the search benchmark (default 14)
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <vector>
+#include "eval.h"
+#include "search.h"
+
+static std::atomic<uint64_t> allocations(0);
+
+// Count every heap allocation made while benchmarking
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+struct TBenchPosition {
+    const char *phase;
+    const char *fen;
+};
+
+static const TBenchPosition Corpus[] = {
+        {"opening",    "B:W21-32:B1-12"},
+        {"opening",    "W:W21-32:B1-10,12,15"},
+        {"opening",    "B:W20,21,22,23,25-32:B1-10,12,15"},
+        {"middlegame", "B:W18,19,21,23,24,26,27,28,30,31,32:B1,2,3,5,6,7,9,10,11,12,14"},
+        {"middlegame", "W:W17,21,22,24,25,26,27,29,30,31:B1,2,3,4,6,8,9,10,12,15,16"},
+        {"middlegame", "B:W14,19,22,25,27,28,30:B3,5,6,8,11,12,16"},
+        {"endgame",    "W:WK10,19,27:B14,K23,22"},
+        {"endgame",    "B:WK27,K32,31:BK1,K6"},
+        {"endgame",    "W:W32,K14:B5,K19"},
+};
+
+const int CorpusSize = sizeof(Corpus) / sizeof(Corpus[0]);
+
+static const char *const DraughtsCorpus[] = {
+        "W:W31-50:B1-20",
+        "B:W27,28,31-33,35-39,41-50:B1-13,15-17,19,20,22,24",
+        "W:W25,27,28,30,32,33,37,38,41,44:B8,9,12,13,15,17,18,20,24,26",
+        "W:WK46,K5,37:B41,32,23,10,19,K2",
+};
+
+const int DraughtsCorpusSize = sizeof(DraughtsCorpus) / sizeof(DraughtsCorpus[0]);
+
+struct TBenchState {
+    TBoard board;
+    int side;
+    TMoveList moves;
+};
+
+// Results are folded in here so the work can't be optimized away
+static volatile uint64_t sink;
+
+typedef std::chrono::steady_clock TClock;
+
+static double secondsSince(TClock::time_point start)
+{
+    return std::chrono::duration<double>(TClock::now() - start).count();
+}
+
+/****************************************************************************
+ * Write the result of one benchmark.
+ * @param name
+ * @param ops - Operations timed
+ * @param seconds
+ * @param allocs - Allocations made during the operations
+ */
+static void report(const char *name, uint64_t ops, double seconds, uint64_t allocs)
+{
+    printf("{\"bench\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.2f,\"allocs_per_op\":%.4f}\n",
+           name, static_cast<unsigned long long>(ops), ops ? seconds * 1e9 / ops : 0.0,
+           ops ? static_cast<double>(allocs) / ops : 0.0);
+}
+
+static void benchValidMoves(const TBenchState *states, int iterations)
+{
+    uint64_t total = 0;
+    uint64_t allocs = allocations;
+    TClock::time_point start = TClock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (int idx = 0; idx < CorpusSize; idx++) {
+            TMoveList moves;
+            getValidMoves(states[idx].board, states[idx].side, moves);
+            total += moves.size();
+        }
+    }
+    double seconds = secondsSince(start);
+    sink = sink + total;
+    report("getValidMoves", static_cast<uint64_t>(iterations) * CorpusSize, seconds, allocations - allocs);
+}
+
+static void benchScore(const TBenchState *states, int iterations)
+{
+    uint64_t total = 0;
+    uint64_t allocs = allocations;
+    TClock::time_point start = TClock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (int idx = 0; idx < CorpusSize; idx++)
+            total += getScore(states[idx].board, states[idx].side);
+    }
+    double seconds = secondsSince(start);
+    sink = sink + total;
+    report("getScore", static_cast<uint64_t>(iterations) * CorpusSize, seconds, allocations - allocs);
+}
+
+static void benchDoMove(const TBenchState *states, int iterations)
+{
+    uint64_t total = 0;
+    uint64_t ops = 0;
+    uint64_t allocs = allocations;
+    TClock::time_point start = TClock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (int idx = 0; idx < CorpusSize; idx++) {
+            for (TMove move : states[idx].moves) {
+                TBoard board = states[idx].board;
+                doMove(board, move);
+                total += board.hash;
+            }
+            ops += states[idx].moves.size();
+        }
+    }
+    double seconds = secondsSince(start);
+    sink = sink + total;
+    report("doMove", ops, seconds, allocations - allocs);
+}
+
+static void benchMakeUnmake(TBenchState *states, int iterations)
+{
+    uint64_t total = 0;
+    uint64_t ops = 0;
+    uint64_t allocs = allocations;
+    TClock::time_point start = TClock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (int idx = 0; idx < CorpusSize; idx++) {
+            TBoard &board = states[idx].board;
+            for (TMove move : states[idx].moves) {
+                TUndo undo;
+                makeMove(board, move, undo);
+                total += board.hash;
+                unmakeMove(board, move, undo);
+            }
+            ops += states[idx].moves.size();
+        }
+    }
+    double seconds = secondsSince(start);
+    sink = sink + total;
+    report("makeMove+unmakeMove", ops, seconds, allocations - allocs);
+}
+
+/****************************************************************************
+ * Score a batch made of the corpus positions and the positions after each
+ * of their moves, with every batch evaluation the processor supports. The
+ * batch scores are checked against getScore() first.
+ */
+static void benchScores(const TBenchState *states, int iterations)
+{
+    std::vector<TBoard> boards;
+    std::vector<int> sides;
+    for (int idx = 0; idx < CorpusSize; idx++) {
+        boards.push_back(states[idx].board);
+        sides.push_back(states[idx].side);
+        for (TMove move : states[idx].moves) {
+            TBoard board = states[idx].board;
+            doMove(board, move);
+            boards.push_back(board);
+            sides.push_back(states[idx].side ^ 1);
+        }
+    }
+    // A side with no pieces left
+    boards.push_back(makeBoard(0, 0x00100000, 0));
+    sides.push_back(Black);
+    boards.push_back(makeBoard(0, 0x00100000, 0));
+    sides.push_back(Red);
+    int count = static_cast<int>(boards.size());
+    std::vector<int> scores(boards.size());
+
+    for (int backend = EvalScalar; backend <= bestEvalBackend(); backend++) {
+        TEvalBackend eval = static_cast<TEvalBackend>(backend);
+        getScores(boards.data(), sides.data(), scores.data(), count, eval);
+        for (int idx = 0; idx < count; idx++) {
+            if (scores[idx] != getScore(boards[idx], sides[idx])) {
+                fprintf(stderr, "%s batch score differs from getScore\n", evalBackendName(eval));
+                exit(1);
+            }
+        }
+
+        uint64_t total = 0;
+        uint64_t allocs = allocations;
+        TClock::time_point start = TClock::now();
+        for (int i = 0; i < iterations; i++) {
+            getScores(boards.data(), sides.data(), scores.data(), count, eval);
+            total += scores[i % count];
+        }
+        double seconds = secondsSince(start);
+        sink = sink + total;
+        char name[32];
+        snprintf(name, sizeof(name), "getScores/%s", evalBackendName(eval));
+        report(name, static_cast<uint64_t>(iterations) * count, seconds, allocations - allocs);
+    }
+} // benchScores
+
+/****************************************************************************
+ * Search each position to a fixed depth with a fresh table, reporting the
+ * time and nodes for each phase and for the whole corpus.
+ */
+static void benchSearch(const TBenchState *states, int depth)
+{
+    const char *phases[] = {"opening", "middlegame", "endgame", nullptr};
+    TTranspositionTable tt(16);
+    TSearchLimits limits = {depth, 0, 0, nullptr};
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+
+    for (int phase = 0; phases[phase]; phase++) {
+        uint64_t nodes = 0;
+        uint64_t searches = 0;
+        uint64_t allocs = allocations;
+        double seconds = 0;
+        for (int idx = 0; idx < CorpusSize; idx++) {
+            if (strcmp(Corpus[idx].phase, phases[phase]) != 0)
+                continue;
+            tt.clear();
+            TClock::time_point start = TClock::now();
+            TSearchResult result = searchPosition(tt, states[idx].board, states[idx].side, limits, 1);
+            seconds += secondsSince(start);
+            nodes += result.nodes;
+            searches++;
+        }
+        printf("{\"bench\":\"search\",\"phase\":\"%s\",\"depth\":%d,\"searches\":%llu,\"nodes\":%llu,"
+               "\"ns_per_node\":%.2f,\"nodes_per_sec\":%.0f,\"allocs_per_search\":%.2f}\n",
+               phases[phase], depth, static_cast<unsigned long long>(searches),
+               static_cast<unsigned long long>(nodes), nodes ? seconds * 1e9 / nodes : 0.0,
+               seconds > 0 ? nodes / seconds : 0.0,
+               searches ? static_cast<double>(allocations - allocs) / searches : 0.0);
+        totalNodes += nodes;
+        totalSeconds += seconds;
+    }
+    printf("{\"bench\":\"search\",\"phase\":\"all\",\"depth\":%d,\"nodes\":%llu,\"nodes_per_sec\":%.0f}\n",
+           depth, static_cast<unsigned long long>(totalNodes), totalSeconds > 0 ? totalNodes / totalSeconds : 0.0);
+} // benchSearch
+
+/****************************************************************************
+ * Generate the moves of each international draughts position, then search
+ * each to a fixed depth with a fresh table.
+ */
+static void benchDraughts(int iterations, int depth)
+{
+    TBoardOf<TInternational> boards[DraughtsCorpusSize];
+    int sides[DraughtsCorpusSize];
+    for (int idx = 0; idx < DraughtsCorpusSize; idx++) {
+        if (!parseFen(DraughtsCorpus[idx], boards[idx], sides[idx])) {
+            fprintf(stderr, "Invalid FEN in corpus: %s\n", DraughtsCorpus[idx]);
+            exit(1);
+        }
+    }
+
+    uint64_t total = 0;
+    uint64_t allocs = allocations;
+    TClock::time_point start = TClock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (int idx = 0; idx < DraughtsCorpusSize; idx++) {
+            TMoveListOf<TInternational> moves;
+            getValidMoves(boards[idx], sides[idx], moves);
+            total += moves.size();
+        }
+    }
+    double seconds = secondsSince(start);
+    sink = sink + total;
+    report("getValidMoves/international", static_cast<uint64_t>(iterations) * DraughtsCorpusSize, seconds,
+           allocations - allocs);
+
+    TTranspositionTable tt(16);
+    TSearchLimits limits = {depth, 0, 0, nullptr};
+    uint64_t nodes = 0;
+    seconds = 0;
+    for (int idx = 0; idx < DraughtsCorpusSize; idx++) {
+        tt.clear();
+        start = TClock::now();
+        TSearchResultOf<TInternational> result = searchPosition(tt, boards[idx], sides[idx], limits, 1);
+        seconds += secondsSince(start);
+        nodes += result.nodes;
+    }
+    printf("{\"bench\":\"search\",\"phase\":\"international\",\"depth\":%d,\"searches\":%d,\"nodes\":%llu,"
+           "\"nodes_per_sec\":%.0f}\n",
+           depth, DraughtsCorpusSize, static_cast<unsigned long long>(nodes), seconds > 0 ? nodes / seconds : 0.0);
+} // benchDraughts
+
+int main(int argc, char *argv[])
+{
+    int iterations = 200000;
+    int depth = 14;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--iterations count] [--depth plies]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    TBenchState states[CorpusSize];
+    for (int idx = 0; idx < CorpusSize; idx++) {
+        if (!parseFen(Corpus[idx].fen, states[idx].board, states[idx].side)) {
+            fprintf(stderr, "Invalid FEN in corpus: %s\n", Corpus[idx].fen);
+            return 1;
+        }
+        getValidMoves(states[idx].board, states[idx].side, states[idx].moves);
+    }
+
+    benchValidMoves(states, iterations);
+    benchScore(states, iterations);
+    benchScores(states, iterations);
+    benchDoMove(states, iterations);
+    benchMakeUnmake(states, iterations);
+    benchSearch(states, depth);
+    benchDraughts(iterations, std::max(1, depth - 4));
+    return 0;
+} // main
@@ -0,0 +1,701 @@
+/****************************************************************************
+* Bitboard move generation.
+*
+* Moves are generated for every piece of a side at once: the piece masks are
+* shifted one step in each diagonal direction and masked against the empty
+* or opponent squares, so no per-square loops or bounds checks are needed.
+* A piece found to have a jump then follows each of its capture paths
+* square by square, looking up its neighbours in tables built at compile
+* time, and every path becomes one move taking all its pieces. Flying kings
+* follow each diagonal square by square in the same tables.
+*
+* Every function is a template on the rules variant, instantiated at the
+* end of the file for TAmerican and TInternational. The rules are
+* constants of the variant, so the tests on them compile away.
+****************************************************************************/
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "board.h"
+
+enum TDirection {
+    DownLeft, DownRight, UpLeft, UpRight
+};
+
+static const int Reverse[4] = {UpRight, UpLeft, DownRight, DownLeft};
+
+/****************************************************************************
+ * The squares one and two steps from each square in each direction, by
+ * square and TDirection. Squares off the board are NoSquare and their
+ * masks are 0, so a test against a mask needs no bounds check.
+ */
+template <class V>
+struct TSquareTables {
+    int8_t neighbour[V::Squares][4];
+    int8_t landing[V::Squares][4];                      // where a jump in the direction ends
+    typename V::TMask neighbourMask[V::Squares][4];
+    typename V::TMask landingMask[V::Squares][4];
+};
+
+template <class V>
+constexpr TSquareTables<V> makeSquareTables()
+{
+    const int rowStep[4] = {1, 1, -1, -1};
+    const int colStep[4] = {-1, 1, -1, 1};
+    TSquareTables<V> t = {};
+    for (int square = 0; square < V::Squares; square++) {
+        int rowIdx = square / V::RowSquares;
+        int colIdx = (square % V::RowSquares) * 2 + ((rowIdx & 1) ? 0 : 1);
+        for (int dir = DownLeft; dir <= UpRight; dir++) {
+            int targets[2] = {NoSquare, NoSquare};
+            for (int dist = 1; dist <= 2; dist++) {
+                int row = rowIdx + rowStep[dir] * dist;
+                int col = colIdx + colStep[dir] * dist;
+                if (row >= 0 && row < V::Rows && col >= 0 && col < V::Cols)
+                    targets[dist - 1] = row * V::RowSquares + col / 2;
+            }
+            t.neighbour[square][dir] = static_cast<int8_t>(targets[0]);
+            t.landing[square][dir] = static_cast<int8_t>(targets[1]);
+            t.neighbourMask[square][dir] =
+                    (targets[0] == NoSquare) ? 0 : static_cast<typename V::TMask>(1) << targets[0];
+            t.landingMask[square][dir] =
+                    (targets[1] == NoSquare) ? 0 : static_cast<typename V::TMask>(1) << targets[1];
+        }
+    }
+    return t;
+}
+
+template <class V>
+static constexpr TSquareTables<V> SquareTables = makeSquareTables<V>();
+
+/****************************************************************************
+ * Move every square in the mask one step in the given direction.
+ * @param mask
+ * @param dir
+ * @return
+ */
+template <class V>
+static inline typename V::TMask step(typename V::TMask mask, int dir)
+{
+    switch (dir) {
+        case DownLeft:
+            return downLeft<V>(mask);
+        case DownRight:
+            return downRight<V>(mask);
+        case UpLeft:
+            return upLeft<V>(mask);
+        default:
+            return upRight<V>(mask);
+    }
+}
+
+/****************************************************************************
+ * Pieces of the side that may move in the given direction. Men only move
+ * forward, kings move both ways.
+ * @param board
+ * @param side
+ * @param movers - Pieces to consider
+ * @param dir
+ * @return
+ */
+template <class V>
+static inline typename V::TMask movingPieces(const TBoardOf<V> &board, int side, typename V::TMask movers, int dir)
+{
+    bool forward = (dir == DownLeft || dir == DownRight) == (side == Black);
+    return forward ? movers : (movers & board.kings);
+}
+
+/****************************************************************************
+ * Add a capture path to the list unless it is already there. A king can
+ * take the same pieces in a loop either way round. When only the jumps
+ * taking the most pieces are legal, shorter paths are dropped.
+ * @param moves
+ * @param move
+ * @param most - Most pieces taken by a path in the list
+ */
+template <class V>
+static inline void addCapture(TMoveListOf<V> &moves, TMoveOf<V> move, int &most)
+{
+    if (V::MostCaptures) {
+        int count = bitCount(move.captured);
+        if (count < most)
+            return;
+        if (count > most) {
+            moves.clear();
+            most = count;
+        }
+    }
+    for (TMoveOf<V> m : moves) {
+        if (m == move)
+            return;
+    }
+    moves.add(move);
+}
+
+/****************************************************************************
+ * Add every capture path of a piece from the square it has reached. The
+ * square the piece started on is empty for the rest of the path, and so
+ * are the pieces taken unless the variant's jumped pieces block. A path
+ * ends when the piece can't jump again, or when a man is crowned if that
+ * ends the jump.
+ * @param board
+ * @param side
+ * @param from - Square the piece started on
+ * @param square - Square it has reached
+ * @param captured - Pieces taken so far
+ * @param moves
+ * @param most - See addCapture()
+ */
+template <class V>
+static void addCapturePaths(const TBoardOf<V> &board, int side, int from, int square,
+                            typename V::TMask captured, TMoveListOf<V> &moves, int &most)
+{
+    typedef typename V::TMask TMask;
+    const TSquareTables<V> &tables = SquareTables<V>;
+    TMask fromMask = squareMask<V>(from);
+    TMask opponents = board.pieces[side ^ 1] & ~captured;
+    TMask empty = emptySquares(board) | fromMask | (V::JumpedPiecesBlock ? 0 : captured);
+    bool man = !(board.kings & fromMask);
+    bool extended = false;
+
+    for (int dir = DownLeft; dir <= UpRight; dir++) {
+        if (man && !V::MenJumpBackward && !movingPieces(board, side, fromMask, dir))
+            continue;
+        if (man || !V::FlyingKings) {
+            TMask over = tables.neighbourMask[square][dir];
+            if (!(over & opponents) || !(tables.landingMask[square][dir] & empty))
+                continue;
+            int to = tables.landing[square][dir];
+            extended = true;
+            if (V::CrowningEndsJump && man && (squareMask<V>(to) & kingRow<V>(side)))
+                addCapture(moves, packMove<V>(from, to, captured | over), most); // crowning ends the turn
+            else
+                addCapturePaths(board, side, from, to, captured | over, moves, most);
+            continue;
+        }
+
+        // A flying king passes any empty squares to the piece it takes and
+        // may land on any empty square beyond it
+        int over = tables.neighbour[square][dir];
+        while (over != NoSquare && (squareMask<V>(over) & empty))
+            over = tables.neighbour[over][dir];
+        if (over == NoSquare || !(squareMask<V>(over) & opponents))
+            continue;
+        TMask overMask = squareMask<V>(over);
+        for (int to = tables.neighbour[over][dir]; to != NoSquare && (squareMask<V>(to) & empty);
+             to = tables.neighbour[to][dir]) {
+            extended = true;
+            addCapturePaths(board, side, from, to, captured | overMask, moves, most);
+        }
+    }
+    if (!extended && captured)
+        addCapture(moves, packMove<V>(from, square, captured), most);
+} // addCapturePaths
+
+/****************************************************************************
+ * Pieces of the side that may be able to make a jump. Men and short kings
+ * are only included when they can jump, flying kings always are.
+ * @param board
+ * @param side
+ * @return
+ */
+template <class V>
+static typename V::TMask jumpingPieces(const TBoardOf<V> &board, int side)
+{
+    typedef typename V::TMask TMask;
+    TMask own = board.pieces[side];
+    TMask opponents = board.pieces[side ^ 1];
+    TMask empty = emptySquares(board);
+    TMask jumpers = V::FlyingKings ? (own & board.kings) : 0;
+    TMask stepping = V::FlyingKings ? (own & ~board.kings) : own;
+
+    for (int dir = DownLeft; dir <= UpRight; dir++) {
+        TMask movers = V::MenJumpBackward ? stepping : movingPieces(board, side, stepping, dir);
+        TMask landing = step<V>(step<V>(movers, dir) & opponents, dir) & empty;
+        jumpers |= step<V>(step<V>(landing, Reverse[dir]), Reverse[dir]);
+    }
+    return jumpers;
+}
+
+/****************************************************************************
+ * Get a list of valid moves for the specified side. When any jump is
+ * available only jumps are returned, each the whole of a multiple jump.
+ * @param board
+ * @param side
+ * @param moves - Cleared and filled with the moves
+ */
+template <class V>
+void getValidMoves(const TBoardOf<V> &board, int side, TMoveListOf<V> &moves)
+{
+    typedef typename V::TMask TMask;
+    const TSquareTables<V> &tables = SquareTables<V>;
+
+    getCaptures(board, side, moves);
+    if (moves.size() > 0)
+        return;
+
+    TMask own = board.pieces[side];
+    TMask empty = emptySquares(board);
+    // Flying kings are moved below, one diagonal at a time
+    TMask steppers = V::FlyingKings ? (own & ~board.kings) : own;
+    for (int dir = DownLeft; dir <= UpRight; dir++) {
+        TMask targets = step<V>(movingPieces(board, side, steppers, dir), dir) & empty;
+        while (targets) {
+            int to = firstSquare(targets);
+            moves.add(packMove<V>(tables.neighbour[to][Reverse[dir]], to));
+            targets &= targets - 1;
+        }
+    }
+    if (V::FlyingKings) {
+        for (TMask kings = own & board.kings; kings; kings &= kings - 1) {
+            int from = firstSquare(kings);
+            for (int dir = DownLeft; dir <= UpRight; dir++) {
+                for (int to = tables.neighbour[from][dir]; to != NoSquare && (squareMask<V>(to) & empty);
+                     to = tables.neighbour[to][dir])
+                    moves.add(packMove<V>(from, to));
+            }
+        }
+    }
+} // getValidMoves
+
+/****************************************************************************
+ * Get the jumps for the specified side, which are all of its valid moves
+ * when there are any. Cheaper than getValidMoves() when only the jumps are
+ * wanted.
+ * @param board
+ * @param side
+ * @param moves - Cleared and filled with the jumps, empty if there are none
+ */
+template <class V>
+void getCaptures(const TBoardOf<V> &board, int side, TMoveListOf<V> &moves)
+{
+    int most = 0;
+
+    moves.clear();
+    for (typename V::TMask jumpers = jumpingPieces(board, side); jumpers; jumpers &= jumpers - 1)
+        addCapturePaths(board, side, firstSquare(jumpers), firstSquare(jumpers), 0, moves, most);
+}
+
+/****************************************************************************
+ * Check whether the side has a move that isn't a jump, without generating
+ * the moves. Any piece, flying king or not, that can step to a neighbouring
+ * square has one.
+ * @param board
+ * @param side
+ * @return
+ */
+template <class V>
+bool hasQuietMoves(const TBoardOf<V> &board, int side)
+{
+    typename V::TMask own = board.pieces[side];
+    typename V::TMask empty = emptySquares(board);
+
+    for (int dir = DownLeft; dir <= UpRight; dir++) {
+        if (step<V>(movingPieces(board, side, own, dir), dir) & empty)
+            return true;
+    }
+    return false;
+}
+
+/****************************************************************************
+ * Get the squares strictly between two squares on one diagonal.
+ * @param from
+ * @param to
+ * @return The squares, 0 if the squares aren't on a diagonal or are next
+ *         to each other.
+ */
+template <class V>
+typename V::TMask squaresBetween(int from, int to)
+{
+    const TSquareTables<V> &tables = SquareTables<V>;
+
+    for (int dir = DownLeft; dir <= UpRight; dir++) {
+        typename V::TMask between = 0;
+        for (int square = tables.neighbour[from][dir]; square != NoSquare; square = tables.neighbour[square][dir]) {
+            if (square == to)
+                return between;
+            between |= squareMask<V>(square);
+        }
+    }
+    return 0;
+}
+
+/****************************************************************************
+ * Get the square passed over by a single hop of a man.
+ * @param from
+ * @param to
+ * @return Mask of the jumped square, 0 if to isn't a hop away from from.
+ */
+template <class V>
+typename V::TMask jumpedSquare(int from, int to)
+{
+    typename V::TMask between = squaresBetween<V>(from, to);
+    return (bitCount(between) == 1) ? between : 0;
+}
+
+/****************************************************************************
+ * Make a move in place, removing any captured checkers and crowning a man
+ * that ends on the far row.
+ * @param board
+ * @param move
+ * @param undo - Filled with what unmakeMove() needs to take the move back
+ */
+template <class V>
+void makeMove(TBoardOf<V> &board, TMoveOf<V> move, TUndoOf<V> &undo)
+{
+    typedef typename V::TMask TMask;
+    const TZobristOf<V> &zobrist = Zobrist<V>;
+    const TPieceValuesOf<V> &values = PieceValues<V>;
+    TMask fromMask = squareMask<V>(move.from());
+    TMask toMask = squareMask<V>(move.to());
+    int side = (board.pieces[Black] & fromMask) ? Black : Red;
+    int piece = side;
+
+    undo.hash = board.hash;
+    undo.material[Black] = board.material[Black];
+    undo.material[Red] = board.material[Red];
+    undo.capturedKings = board.kings & move.captured;
+    undo.promoted = false;
+    for (TMask taken = move.captured; taken; taken &= taken - 1) {
+        int square = firstSquare(taken);
+        int capturedPiece = (side ^ 1) + ((undo.capturedKings & squareMask<V>(square)) ? 2 : 0);
+        board.hash ^= zobrist.pieces[capturedPiece][square];
+        board.material[side ^ 1] -= values.values[capturedPiece][square];
+    }
+    board.pieces[side ^ 1] &= ~move.captured;
+    board.kings &= ~move.captured;
+
+    // A jump may end where it began, the masks then cancel
+    board.pieces[side] ^= fromMask ^ toMask;
+    if (board.kings & fromMask) {
+        board.kings ^= fromMask ^ toMask;
+        piece += 2;
+        board.hash ^= zobrist.pieces[piece][move.from()] ^ zobrist.pieces[piece][move.to()];
+        board.material[side] += values.values[piece][move.to()] - values.values[piece][move.from()];
+    } else if (toMask & kingRow<V>(side)) {
+        board.kings |= toMask;
+        board.hash ^= zobrist.pieces[piece][move.from()] ^ zobrist.pieces[piece + 2][move.to()];
+        board.material[side] += values.values[piece + 2][move.to()] - values.values[piece][move.from()];
+        undo.promoted = true;
+    } else {
+        board.hash ^= zobrist.pieces[piece][move.from()] ^ zobrist.pieces[piece][move.to()];
+        board.material[side] += values.values[piece][move.to()] - values.values[piece][move.from()];
+    }
+} // makeMove
+
+/****************************************************************************
+ * Take back a move made by makeMove(), restoring any captured checkers and
+ * uncrowning a man that was crowned by the move.
+ * @param board
+ * @param move
+ * @param undo
+ */
+template <class V>
+void unmakeMove(TBoardOf<V> &board, TMoveOf<V> move, const TUndoOf<V> &undo)
+{
+    typename V::TMask fromMask = squareMask<V>(move.from());
+    typename V::TMask toMask = squareMask<V>(move.to());
+    int side = (board.pieces[Black] & toMask) ? Black : Red;
+
+    board.pieces[side] ^= fromMask ^ toMask;
+    if (board.kings & toMask) {
+        board.kings ^= toMask;
+        if (!undo.promoted)
+            board.kings |= fromMask;
+    }
+    board.pieces[side ^ 1] |= move.captured;
+    board.kings |= undo.capturedKings;
+    board.hash = undo.hash;
+    board.material[Black] = undo.material[Black];
+    board.material[Red] = undo.material[Red];
+} // unmakeMove
+
+/****************************************************************************
+ * Move the selected checker on the board.
+ * @param board
+ * @param move
+ */
+template <class V>
+void doMove(TBoardOf<V> &board, TMoveOf<V> move)
+{
+    TUndoOf<V> undo;
+    makeMove(board, move, undo);
+}
+
+/****************************************************************************
+ * Convert a checker color character to a side index.
+ * @param color - 'b', 'r' or their king letters
+ * @return Black or Red
+ */
+int sideOf(char color)
+{
+    return ((color | 0x20) == 'r') ? Red : Black;
+}
+
+/****************************************************************************
+ * Convert a 1 based row,col location to a square number.
+ * @param loc
+ * @return Square number, or -1 for a light (unplayable) square.
+ */
+template <class V>
+int locationToSquare(TLocation loc)
+{
+    int rowIdx = loc.row - 1;
+    int colIdx = loc.col - 1;
+    if (rowIdx < 0 || rowIdx >= V::Rows || colIdx < 0 || colIdx >= V::Cols || ((rowIdx + colIdx) & 1) == 0)
+        return -1;
+    return (rowIdx * V::RowSquares) + (colIdx / 2);
+}
+
+template <class V>
+TLocation squareToLocation(int square)
+{
+    TLocation loc;
+    int rowIdx = square / V::RowSquares;
+    loc.row = rowIdx + 1;
+    loc.col = ((square % V::RowSquares) * 2) + ((rowIdx & 1) ? 1 : 2);
+    return loc;
+}
+
+/****************************************************************************
+ * Get the character shown for a board position.
+ * @param board
+ * @param rowIdx
+ * @param colIdx
+ * @return 'b', 'r', upper case for kings, or ' ' for an empty square.
+ */
+template <class V>
+char pieceAt(const TBoardOf<V> &board, int rowIdx, int colIdx)
+{
+    TLocation loc = {rowIdx + 1, colIdx + 1};
+    int square = locationToSquare<V>(loc);
+    if (square < 0)
+        return ' ';
+    typename V::TMask mask = squareMask<V>(square);
+    char c = ' ';
+    if (board.pieces[Black] & mask)
+        c = 'b';
+    else if (board.pieces[Red] & mask)
+        c = 'r';
+    if (board.kings & mask)
+        c &= 0xDF; // to upper
+    return c;
+} // pieceAt
+
+/****************************************************************************
+ * Write the hops of a jump from a square, each as an x and the square
+ * landed on, so that they take every piece left in the mask.
+ * @param flying - Allow hops over empty squares, as a flying king makes
+ * @return false if no order of hops takes them all and ends on to.
+ */
+template <class V>
+static bool writeHops(int square, int to, typename V::TMask left, bool flying, char *text)
+{
+    const TSquareTables<V> &tables = SquareTables<V>;
+
+    if (!left) {
+        *text = '\0';
+        return square == to;
+    }
+    for (int dir = DownLeft; dir <= UpRight; dir++) {
+        int over = tables.neighbour[square][dir];
+        while (flying && over != NoSquare && !(squareMask<V>(over) & left))
+            over = tables.neighbour[over][dir];
+        if (over == NoSquare || !(squareMask<V>(over) & left))
+            continue;
+        for (int landing = tables.neighbour[over][dir]; landing != NoSquare && !(squareMask<V>(landing) & left);
+             landing = tables.neighbour[landing][dir]) {
+            int len = snprintf(text, 4, "x%d", landing + 1);
+            if (writeHops<V>(landing, to, left & ~squareMask<V>(over), flying, text + len))
+                return true;
+            if (!flying)
+                break;
+        }
+    }
+    return false;
+} // writeHops
+
+/****************************************************************************
+ * Write a move in PDN notation, using the standard square numbers from 1,
+ * e.g. "11-15" for a step or "15x22x29" for a jump, with every square
+ * landed on. A flying king's hops are written landing as near the pieces
+ * it takes as will make the path.
+ * @param move
+ * @param text - At least MoveTextSize characters
+ */
+template <class V>
+void moveToText(TMoveOf<V> move, char *text)
+{
+    int len = snprintf(text, MoveTextSize, "%d", move.from() + 1);
+    if (!move.isJump())
+        snprintf(text + len, MoveTextSize - len, "-%d", move.to() + 1);
+    else if (!writeHops<V>(move.from(), move.to(), move.captured, false, text + len) &&
+             !(V::FlyingKings && writeHops<V>(move.from(), move.to(), move.captured, true, text + len)))
+        snprintf(text + len, MoveTextSize - len, "x%d", move.to() + 1);
+}
+
+/****************************************************************************
+ * Read a move in PDN notation, see moveToText(). A jump may list every
+ * square landed on, or only its first and last square when no other jump
+ * shares them.
+ * @param text
+ * @param moves - The legal moves
+ * @param move - Set to the move
+ * @return false if the text is no legal move, or could be more than one.
+ */
+template <class V>
+bool parseMove(const char *text, const TMoveListOf<V> &moves, TMoveOf<V> &move)
+{
+    char *end;
+    long square = strtol(text, &end, 10);
+    const char *p = end;
+    int from = static_cast<int>(square) - 1;
+    int to = from;
+    typename V::TMask passed = 0;  // squares hopped over
+    int hops = 0;
+    bool jump = false;
+
+    if (p == text || square < 1 || square > V::Squares)
+        return false;
+    while (*p == '-' || *p == 'x' || *p == 'X') {
+        jump = (*p != '-');
+        square = strtol(p + 1, &end, 10);
+        if (end == p + 1 || square < 1 || square > V::Squares)
+            return false;
+        passed |= squaresBetween<V>(to, static_cast<int>(square) - 1);
+        to = static_cast<int>(square) - 1;
+        hops++;
+        p = end;
+    }
+    if (*p != '\0' || hops == 0 || (!jump && hops > 1))
+        return false;
+
+    TMoveOf<V> wanted = packMove<V>(from, to, jump ? passed : 0);
+    int matches = 0;
+    for (TMoveOf<V> m : moves) {
+        if (m.packed != wanted.packed)
+            continue;
+        // Each hop takes one of the pieces it passes over
+        if (!jump || (hops > 1 && !(m.captured & ~passed) && bitCount(m.captured) == hops)) {
+            move = m;
+            return true;
+        }
+        if (hops == 1) {
+            move = m;
+            matches++;
+        }
+    }
+    return matches == 1;
+} // parseMove
+
+/****************************************************************************
+ * Read a position in PDN FEN notation, e.g. "B:W18,24,K27:B12,16". The
+ * first letter is the side to move, then each side's pieces are listed
+ * with K before a king. Ranges such as "B1-12" are accepted. White is red.
+ * @param fen
+ * @param board - Set to the position
+ * @param side - Set to the side to move
+ * @return false if the text is not a valid position.
+ */
+template <class V>
+bool parseFen(const char *fen, TBoardOf<V> &board, int &side)
+{
+    typename V::TMask pieces[2] = {0, 0};
+    typename V::TMask kings = 0;
+    const char *p = fen;
+
+    while (isspace(static_cast<unsigned char>(*p)))
+        p++;
+    char turn = static_cast<char>(toupper(static_cast<unsigned char>(*p++)));
+    if (turn != 'B' && turn != 'W')
+        return false;
+    side = (turn == 'B') ? Black : Red;
+
+    while (*p == ':') {
+        p++;
+        char color = static_cast<char>(toupper(static_cast<unsigned char>(*p++)));
+        if (color != 'B' && color != 'W')
+            return false;
+        int owner = (color == 'B') ? Black : Red;
+        while (*p && *p != ':' && !isspace(static_cast<unsigned char>(*p))) {
+            bool king = false;
+            if (*p == 'K' || *p == 'k') {
+                king = true;
+                p++;
+            }
+            char *end;
+            long first = strtol(p, &end, 10);
+            long last = first;
+            if (end == p)
+                return false;
+            p = end;
+            if (*p == '-') {
+                p++;
+                last = strtol(p, &end, 10);
+                if (end == p)
+                    return false;
+                p = end;
+            }
+            if (first < 1 || last > V::Squares || first > last)
+                return false;
+            for (long number = first; number <= last; number++) {
+                typename V::TMask mask = squareMask<V>(static_cast<int>(number) - 1);
+                pieces[owner] |= mask;
+                if (king)
+                    kings |= mask;
+            }
+            if (*p == ',')
+                p++;
+        }
+    }
+    if (pieces[Black] & pieces[Red])
+        return false;
+
+    board = makeBoard<V>(pieces[Black], pieces[Red], kings);
+    return true;
+} // parseFen
+
+/****************************************************************************
+ * Write a position in PDN FEN notation, see parseFen().
+ * @param board
+ * @param side - Side to move
+ * @param text
+ * @param size - Size of text, FenTextSize is always enough
+ */
+template <class V>
+void boardToFen(const TBoardOf<V> &board, int side, char *text, int size)
+{
+    int len = snprintf(text, size, "%c", (side == Black) ? 'B' : 'W');
+    const int order[2] = {Red, Black};
+
+    for (int owner : order) {
+        len += snprintf(text + len, size > len ? size - len : 0, ":%c", (owner == Black) ? 'B' : 'W');
+        const char *separator = "";
+        for (typename V::TMask pieces = board.pieces[owner]; pieces; pieces &= pieces - 1) {
+            int square = firstSquare(pieces);
+            len += snprintf(text + len, size > len ? size - len : 0, "%s%s%d", separator,
+                            (board.kings & squareMask<V>(square)) ? "K" : "", square + 1);
+            separator = ",";
+        }
+    }
+} // boardToFen
+
+#define INSTANTIATE_BOARD(V) \
+    template int locationToSquare<V>(TLocation loc); \
+    template TLocation squareToLocation<V>(int square); \
+    template char pieceAt(const TBoardOf<V> &board, int rowIdx, int colIdx); \
+    template void moveToText(TMoveOf<V> move, char *text); \
+    template bool parseMove(const char *text, const TMoveListOf<V> &moves, TMoveOf<V> &move); \
+    template bool parseFen(const char *fen, TBoardOf<V> &board, int &side); \
+    template void boardToFen(const TBoardOf<V> &board, int side, char *text, int size); \
+    template void getValidMoves(const TBoardOf<V> &board, int side, TMoveListOf<V> &moves); \
+    template void getCaptures(const TBoardOf<V> &board, int side, TMoveListOf<V> &moves); \
+    template bool hasQuietMoves(const TBoardOf<V> &board, int side); \
+    template V::TMask squaresBetween<V>(int from, int to); \
+    template V::TMask jumpedSquare<V>(int from, int to); \
+    template void makeMove(TBoardOf<V> &board, TMoveOf<V> move, TUndoOf<V> &undo); \
+    template void unmakeMove(TBoardOf<V> &board, TMoveOf<V> move, const TUndoOf<V> &undo); \
+    template void doMove(TBoardOf<V> &board, TMoveOf<V> move);
+
+INSTANTIATE_BOARD(TAmerican)
+INSTANTIATE_BOARD(TInternational)
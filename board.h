@@ -0,0 +1,544 @@
+/****************************************************************************
+* Bitboard board representation and move generation.
+*
+* The board and its moves are templates on the rules variant, a class of
+* compile time constants giving the size of the board, the mask type and
+* the capture rules, so each variant is compiled with its geometry and
+* rules built in. TAmerican is American checkers on an 8x8 board and
+* TInternational is international draughts on a 10x10 board. TBoard, TMove
+* and the other plain names are the American types.
+*
+* Only the dark squares of the board are playable. They are numbered from
+* 0, half a row's worth to a row, starting at row 1 and reading left to
+* right (the standard PDN square number minus one). Bit n of a mask is set
+* when square n is occupied.
+*
+* Row 1 is black's home row and black men move down the board, toward the
+* last row. Red men start on the last rows and move up the board, toward
+* row 1. In international draughts red is white.
+****************************************************************************/
+#ifndef CHECKERS_BOARD_H
+#define CHECKERS_BOARD_H
+
+#include <stdint.h>
+
+// Marks a square off the board
+const int NoSquare = -1;
+// Buffer size for moveToText(), enough for a jump taking every piece
+const int MoveTextSize = 64;
+// Buffer size for boardToFen(), enough for every square listed
+const int FenTextSize = 256;
+
+// Side indexes into TBoard::pieces
+const int Black = 0;
+const int Red = 1;
+
+/****************************************************************************
+ * Mask of the squares on rows first to last, counting rows from 0.
+ */
+template <typename TMask>
+constexpr TMask rowSpan(int rowSquares, int first, int last)
+{
+    TMask mask = 0;
+    for (int square = first * rowSquares; square < (last + 1) * rowSquares; square++)
+        mask |= static_cast<TMask>(1) << square;
+    return mask;
+}
+
+/****************************************************************************
+ * Mask of the squares on every other row, from row first.
+ */
+template <typename TMask>
+constexpr TMask alternateRows(int rows, int rowSquares, int first)
+{
+    TMask mask = 0;
+    for (int row = first; row < rows; row += 2)
+        mask |= rowSpan<TMask>(rowSquares, row, row);
+    return mask;
+}
+
+/****************************************************************************
+ * Mask of the squares in the first and last columns. Rows 1,3,5... start
+ * on the second column and end on the last, the others start on the first.
+ */
+template <typename TMask>
+constexpr TMask edgeColumns(int rows, int rowSquares)
+{
+    TMask mask = 0;
+    for (int row = 0; row < rows; row++)
+        mask |= static_cast<TMask>(1) << (row * rowSquares + ((row & 1) ? 0 : rowSquares - 1));
+    return mask;
+}
+
+// Bits needed for a square number
+constexpr int squareBits(int squares)
+{
+    return (squares <= 1) ? 0 : 1 + squareBits((squares + 1) / 2);
+}
+
+/****************************************************************************
+ * Board geometry, the base of each rules variant. Rows and Cols count every
+ * square of the board, the masks only the playable squares.
+ */
+template <typename Mask, int RowCount, int ColCount>
+struct TGeometry {
+    typedef Mask TMask;
+
+    static constexpr int Rows = RowCount;
+    static constexpr int Cols = ColCount;
+    static constexpr int RowSquares = ColCount / 2;
+    static constexpr int Squares = RowCount * RowSquares;
+    // Bits of a square number in TMove::packed
+    static constexpr int SquareBits = squareBits(Squares);
+    static constexpr TMask AllSquares = rowSpan<Mask>(RowSquares, 0, RowCount - 1);
+    // Squares on rows 1,3,5... and rows 2,4,6...
+    static constexpr TMask OddRows = alternateRows<Mask>(RowCount, RowSquares, 0);
+    static constexpr TMask EvenRows = alternateRows<Mask>(RowCount, RowSquares, 1);
+    // Squares in the first and last columns
+    static constexpr TMask EdgeSquares = edgeColumns<Mask>(RowCount, RowSquares);
+    // Rows where black and red men are crowned
+    static constexpr TMask BlackKingRow = rowSpan<Mask>(RowSquares, RowCount - 1, RowCount - 1);
+    static constexpr TMask RedKingRow = rowSpan<Mask>(RowSquares, 0, 0);
+};
+
+template <typename Mask, int R, int C> constexpr int TGeometry<Mask, R, C>::Rows;
+template <typename Mask, int R, int C> constexpr int TGeometry<Mask, R, C>::Cols;
+template <typename Mask, int R, int C> constexpr int TGeometry<Mask, R, C>::RowSquares;
+template <typename Mask, int R, int C> constexpr int TGeometry<Mask, R, C>::Squares;
+template <typename Mask, int R, int C> constexpr int TGeometry<Mask, R, C>::SquareBits;
+template <typename Mask, int R, int C> constexpr Mask TGeometry<Mask, R, C>::AllSquares;
+template <typename Mask, int R, int C> constexpr Mask TGeometry<Mask, R, C>::OddRows;
+template <typename Mask, int R, int C> constexpr Mask TGeometry<Mask, R, C>::EvenRows;
+template <typename Mask, int R, int C> constexpr Mask TGeometry<Mask, R, C>::EdgeSquares;
+template <typename Mask, int R, int C> constexpr Mask TGeometry<Mask, R, C>::BlackKingRow;
+template <typename Mask, int R, int C> constexpr Mask TGeometry<Mask, R, C>::RedKingRow;
+
+/****************************************************************************
+ * American checkers: men step and jump forward only, kings one square
+ * either way, and any jump may be chosen when there are several. Black
+ * moves first.
+ */
+struct TAmerican : TGeometry<uint32_t, 8, 8> {
+    static constexpr int StartRows = 3;             // rows of men each side starts with
+    static constexpr int FirstSide = Black;
+    static constexpr int MaxMoves = 64;             // upper bound on the moves in any position
+    static constexpr bool MenJumpBackward = false;
+    static constexpr bool FlyingKings = false;      // kings move any distance along a diagonal
+    static constexpr bool MostCaptures = false;     // only the jumps taking the most pieces are legal
+    static constexpr bool CrowningEndsJump = true;  // a man that reaches the far row stops there
+    static constexpr bool JumpedPiecesBlock = false; // taken pieces stay on the board until the jump ends
+    static constexpr int VariantId = 0;             // tells the variants' shared tables apart
+};
+
+/****************************************************************************
+ * International draughts: men jump backward as well as forward, kings fly,
+ * the jumps taking the most pieces must be played, and a man that passes
+ * the far row during a jump is only crowned if it ends there. White, which
+ * is red here, moves first.
+ */
+struct TInternational : TGeometry<uint64_t, 10, 10> {
+    static constexpr int StartRows = 4;
+    static constexpr int FirstSide = Red;
+    static constexpr int MaxMoves = 256;
+    static constexpr bool MenJumpBackward = true;
+    static constexpr bool FlyingKings = true;
+    static constexpr bool MostCaptures = true;
+    static constexpr bool CrowningEndsJump = false;
+    static constexpr bool JumpedPiecesBlock = true;
+    static constexpr int VariantId = 1;
+};
+
+// The American board, used by most of the program
+const int Rows = TAmerican::Rows;
+const int Cols = TAmerican::Cols;
+const int Squares = TAmerican::Squares;
+const int MaxMoves = TAmerican::MaxMoves;
+const uint32_t OddRows = TAmerican::OddRows;
+const uint32_t EvenRows = TAmerican::EvenRows;
+const uint32_t EdgeSquares = TAmerican::EdgeSquares;
+const uint32_t KingRow[2] = {TAmerican::BlackKingRow, TAmerican::RedKingRow};
+
+struct TLocation {
+    int row, col;
+
+    bool operator==(const TLocation &a) const
+    {
+        return (row == a.row && col == a.col);
+    }
+};
+
+/****************************************************************************
+ * A whole turn: a step, or a jump with every hop of a multiple jump. The
+ * from square, the square the piece ends on and a jump flag are packed
+ * into 16 bits: from in the low SquareBits bits, to in the next SquareBits
+ * and then the flag. For American checkers that is from in bits 0-4, to in
+ * bits 5-9 and the flag in bit 10. That is all the transposition table and
+ * the opening book keep, and two jumps can share it when they take
+ * different pieces. A king's jump can end where it began.
+ */
+template <class V>
+struct TMoveOf {
+    uint16_t packed;
+    typename V::TMask captured;  // squares of the pieces taken, 0 for a step
+
+    int from() const
+    {
+        return packed & ((1 << V::SquareBits) - 1);
+    }
+
+    int to() const
+    {
+        return (packed >> V::SquareBits) & ((1 << V::SquareBits) - 1);
+    }
+
+    bool isJump() const
+    {
+        return (packed & (1 << (2 * V::SquareBits))) != 0;
+    }
+
+    bool operator==(const TMoveOf &a) const
+    {
+        return packed == a.packed && captured == a.captured;
+    }
+};
+
+typedef TMoveOf<TAmerican> TMove;
+
+template <class V = TAmerican>
+inline TMoveOf<V> packMove(int from, int to, typename V::TMask captured = 0)
+{
+    TMoveOf<V> move;
+    move.packed = static_cast<uint16_t>(from | (to << V::SquareBits) | (captured ? 1 << (2 * V::SquareBits) : 0));
+    move.captured = captured;
+    return move;
+}
+
+/****************************************************************************
+ * Fixed capacity move list, meant to live on the stack so that move
+ * generation never touches the heap.
+ */
+template <class V>
+struct TMoveListOf {
+    TMoveOf<V> moves[V::MaxMoves];
+    int count = 0;
+
+    int size() const
+    {
+        return count;
+    }
+
+    void add(TMoveOf<V> move)
+    {
+        moves[count++] = move;
+    }
+
+    void clear()
+    {
+        count = 0;
+    }
+
+    const TMoveOf<V> &operator[](int idx) const
+    {
+        return moves[idx];
+    }
+
+    TMoveOf<V> &operator[](int idx)
+    {
+        return moves[idx];
+    }
+
+    const TMoveOf<V> *begin() const
+    {
+        return moves;
+    }
+
+    const TMoveOf<V> *end() const
+    {
+        return moves + count;
+    }
+};
+
+typedef TMoveListOf<TAmerican> TMoveList;
+
+template <class V>
+struct TBoardOf {
+    typename V::TMask pieces[2]; // men and kings of each side, indexed by Black/Red
+    typename V::TMask kings;     // kings of either side
+    uint64_t hash;               // Zobrist hash of the pieces, see hashBoard()
+    int material[2];             // sum of PieceValues for each side's pieces
+};
+
+typedef TBoardOf<TAmerican> TBoard;
+
+// What unmakeMove() needs to take back a move
+template <class V>
+struct TUndoOf {
+    uint64_t hash;                      // hash before the move
+    int material[2];                    // material before the move
+    typename V::TMask capturedKings;    // kings among the move's captured pieces
+    bool promoted;                      // the move crowned a man
+};
+
+typedef TUndoOf<TAmerican> TUndo;
+
+/****************************************************************************
+ * Zobrist keys. Piece keys are indexed by side, plus 2 for kings. The keys
+ * are a fixed function of their index so hashes are the same in every
+ * process and can be stored on disk.
+ */
+template <class V>
+constexpr uint64_t zobristKey(int piece, int square)
+{
+    // splitmix64 finalizer
+    uint64_t z = static_cast<uint64_t>(piece * V::Squares + square + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+template <class V>
+struct TZobristOf {
+    uint64_t pieces[4][V::Squares];
+    uint64_t redToMove;
+};
+
+template <class V>
+constexpr TZobristOf<V> makeZobrist()
+{
+    TZobristOf<V> z = {};
+    for (int square = 0; square < V::Squares; square++) {
+        for (int piece = 0; piece < 4; piece++)
+            z.pieces[piece][square] = zobristKey<V>(piece, square);
+    }
+    z.redToMove = zobristKey<V>(5, 0);
+    return z;
+}
+
+template <class V>
+constexpr TZobristOf<V> Zobrist = makeZobrist<V>();
+
+/****************************************************************************
+ * Compute the Zobrist hash of the pieces from scratch. makeMove() keeps
+ * TBoard::hash up to date incrementally.
+ */
+template <class V>
+constexpr uint64_t hashBoard(typename V::TMask black, typename V::TMask red, typename V::TMask kings)
+{
+    uint64_t hash = 0;
+    for (int square = 0; square < V::Squares; square++) {
+        typename V::TMask mask = static_cast<typename V::TMask>(1) << square;
+        int king = (kings & mask) ? 2 : 0;
+        if (black & mask)
+            hash ^= Zobrist<V>.pieces[Black + king][square];
+        else if (red & mask)
+            hash ^= Zobrist<V>.pieces[Red + king][square];
+    }
+    return hash;
+}
+
+/****************************************************************************
+ * Evaluation weights in hundredths of a man, see setEvalWeights() in
+ * eval.h. The piece values below are built from them.
+ */
+struct TEvalWeights {
+    int man;        // man away from the edge
+    int edgeMan;    // man on the edge, where it can't be jumped
+    int king;
+    int win;        // score when the opponent has no pieces left
+};
+
+constexpr TEvalWeights DefaultEvalWeights = {100, 200, 150, 1500};
+// Largest weight, keeping every score well below the search's win scores
+const int MaxEvalWeight = 2000;
+
+/****************************************************************************
+ * Value of a piece on a square, in hundredths of a man, indexed like the
+ * Zobrist piece keys. makeMove() keeps a running total for each side in
+ * TBoard::material, so the evaluation never has to scan the board and
+ * positional terms cost nothing extra at the leaves.
+ */
+template <class V>
+struct TPieceValuesOf {
+    int values[4][V::Squares];
+};
+
+template <class V>
+constexpr TPieceValuesOf<V> makePieceValues(const TEvalWeights &weights)
+{
+    TPieceValuesOf<V> v = {};
+    for (int square = 0; square < V::Squares; square++) {
+        // Men on the edge can't be jumped
+        int man = ((V::EdgeSquares >> square) & 1) ? weights.edgeMan : weights.man;
+        v.values[Black][square] = v.values[Red][square] = man;
+        v.values[Black + 2][square] = v.values[Red + 2][square] = weights.king;
+    }
+    return v;
+}
+
+// Built from the evaluation weights, see setEvalWeights()
+template <class V>
+TPieceValuesOf<V> PieceValues = makePieceValues<V>(DefaultEvalWeights);
+
+/****************************************************************************
+ * Compute a side's material from scratch.
+ */
+template <class V>
+inline int materialOf(typename V::TMask pieces, typename V::TMask kings, int side)
+{
+    int total = 0;
+    for (int square = 0; square < V::Squares; square++) {
+        typename V::TMask mask = static_cast<typename V::TMask>(1) << square;
+        if (pieces & mask)
+            total += PieceValues<V>.values[side + ((kings & mask) ? 2 : 0)][square];
+    }
+    return total;
+}
+
+/****************************************************************************
+ * Build a board from piece masks, filling in the hash and material.
+ */
+template <class V = TAmerican>
+inline TBoardOf<V> makeBoard(typename V::TMask black, typename V::TMask red, typename V::TMask kings)
+{
+    return {{black, red}, kings, hashBoard<V>(black, red, kings),
+            {materialOf<V>(black, kings, Black), materialOf<V>(red, kings, Red)}};
+}
+
+/****************************************************************************
+ * The starting position, V::FirstSide moves first. Made on each call so its
+ * material follows the evaluation weights in use.
+ */
+template <class V = TAmerican>
+inline TBoardOf<V> newBoard()
+{
+    return makeBoard<V>(rowSpan<typename V::TMask>(V::RowSquares, 0, V::StartRows - 1),
+                        rowSpan<typename V::TMask>(V::RowSquares, V::Rows - V::StartRows, V::Rows - 1), 0);
+}
+
+/****************************************************************************
+ * Hash of the position with the side to move, as used by the search.
+ */
+template <class V>
+inline uint64_t positionKey(const TBoardOf<V> &board, int side)
+{
+    return (side == Red) ? board.hash ^ Zobrist<V>.redToMove : board.hash;
+}
+
+/****************************************************************************
+ * Shift every square in the mask one step diagonally. Squares that would
+ * leave the board are dropped.
+ */
+template <class V = TAmerican>
+inline typename V::TMask downLeft(typename V::TMask mask)
+{
+    return (((mask & V::OddRows) << V::RowSquares) | ((mask & V::EvenRows & ~V::EdgeSquares) << (V::RowSquares - 1))) &
+           V::AllSquares;
+}
+
+template <class V = TAmerican>
+inline typename V::TMask downRight(typename V::TMask mask)
+{
+    return (((mask & V::OddRows & ~V::EdgeSquares) << (V::RowSquares + 1)) | ((mask & V::EvenRows) << V::RowSquares)) &
+           V::AllSquares;
+}
+
+template <class V = TAmerican>
+inline typename V::TMask upLeft(typename V::TMask mask)
+{
+    return ((mask & V::OddRows) >> V::RowSquares) | ((mask & V::EvenRows & ~V::EdgeSquares) >> (V::RowSquares + 1));
+}
+
+template <class V = TAmerican>
+inline typename V::TMask upRight(typename V::TMask mask)
+{
+    return ((mask & V::OddRows & ~V::EdgeSquares) >> (V::RowSquares - 1)) | ((mask & V::EvenRows) >> V::RowSquares);
+}
+
+inline int bitCount(uint32_t mask)
+{
+    return __builtin_popcount(mask);
+}
+
+inline int bitCount(uint64_t mask)
+{
+    return __builtin_popcountll(mask);
+}
+
+// Index of the lowest set square, mask must not be zero.
+inline int firstSquare(uint32_t mask)
+{
+    return __builtin_ctz(mask);
+}
+
+inline int firstSquare(uint64_t mask)
+{
+    return __builtin_ctzll(mask);
+}
+
+template <class V = TAmerican>
+inline typename V::TMask squareMask(int square)
+{
+    return static_cast<typename V::TMask>(1) << square;
+}
+
+template <class V>
+inline typename V::TMask emptySquares(const TBoardOf<V> &board)
+{
+    return ~(board.pieces[Black] | board.pieces[Red]) & V::AllSquares;
+}
+
+// Rows where the side's men are crowned
+template <class V>
+inline typename V::TMask kingRow(int side)
+{
+    return (side == Black) ? V::BlackKingRow : V::RedKingRow;
+}
+
+int sideOf(char color);
+
+template <class V = TAmerican>
+int locationToSquare(TLocation loc);
+
+template <class V = TAmerican>
+TLocation squareToLocation(int square);
+
+template <class V>
+char pieceAt(const TBoardOf<V> &board, int rowIdx, int colIdx);
+
+template <class V>
+void moveToText(TMoveOf<V> move, char *text);
+
+template <class V>
+bool parseMove(const char *text, const TMoveListOf<V> &moves, TMoveOf<V> &move);
+
+template <class V>
+bool parseFen(const char *fen, TBoardOf<V> &board, int &side);
+
+template <class V>
+void boardToFen(const TBoardOf<V> &board, int side, char *text, int size);
+
+template <class V>
+void getValidMoves(const TBoardOf<V> &board, int side, TMoveListOf<V> &moves);
+
+template <class V>
+void getCaptures(const TBoardOf<V> &board, int side, TMoveListOf<V> &moves);
+
+template <class V>
+bool hasQuietMoves(const TBoardOf<V> &board, int side);
+
+template <class V = TAmerican>
+typename V::TMask squaresBetween(int from, int to);
+
+template <class V = TAmerican>
+typename V::TMask jumpedSquare(int from, int to);
+
+template <class V>
+void makeMove(TBoardOf<V> &board, TMoveOf<V> move, TUndoOf<V> &undo);
+
+template <class V>
+void unmakeMove(TBoardOf<V> &board, TMoveOf<V> move, const TUndoOf<V> &undo);
+
+template <class V>
+void doMove(TBoardOf<V> &board, TMoveOf<V> move);
+
+#endif // CHECKERS_BOARD_H
@@ -0,0 +1,117 @@
+/****************************************************************************
+* Opening book: the memory mapped lookup.
+****************************************************************************/
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include "book.h"
+
+TOpeningBook::TOpeningBook()
+        : map(nullptr), length(0), entries(nullptr), count(0)
+{
+}
+
+TOpeningBook::~TOpeningBook()
+{
+    close();
+}
+
+/****************************************************************************
+ * Map a book file into memory, replacing any open one.
+ * @param path
+ * @return false if the file can't be read or isn't a book.
+ */
+bool TOpeningBook::open(const char *path)
+{
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TBookHeader)) {
+        ::close(fd);
+        return false;
+    }
+    map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        map = nullptr;
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+
+    TBookHeader header;
+    memcpy(&header, map, sizeof(header));
+    if (header.magic != BookMagic || header.version != BookVersion ||
+        header.entries > (length - sizeof(header)) / sizeof(TBookEntry)) {
+        close();
+        return false;
+    }
+    entries = reinterpret_cast<const TBookEntry *>(static_cast<const uint8_t *>(map) + sizeof(header));
+    count = static_cast<size_t>(header.entries);
+    return true;
+}
+
+void TOpeningBook::close()
+{
+    if (map)
+        munmap(map, length);
+    map = nullptr;
+    length = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+/****************************************************************************
+ * Find the book moves for a position.
+ * @param key - positionKey() of the position
+ * @param moves - Set to the first entry for the position
+ * @return The number of entries for the position, 0 if it isn't in the book.
+ */
+int TOpeningBook::probe(uint64_t key, const TBookEntry **moves) const
+{
+    if (!entries)
+        return 0;
+    const TBookEntry *end = entries + count;
+    const TBookEntry *first = std::lower_bound(entries, end, key, [](const TBookEntry &e, uint64_t k) {
+        return e.key < k;
+    });
+    const TBookEntry *last = first;
+    while (last != end && last->key == key)
+        last++;
+    *moves = first;
+    return static_cast<int>(last - first);
+}
+
+/****************************************************************************
+ * Choose one of a position's book moves, each with a chance in proportion
+ * to its weight.
+ * @param key - positionKey() of the position
+ * @param random - Any random number
+ * @param move - Set to the chosen move
+ * @return false if the position isn't in the book.
+ */
+bool TOpeningBook::pick(uint64_t key, uint32_t random, TMove &move) const
+{
+    const TBookEntry *moves;
+    int n = probe(key, &moves);
+    uint32_t total = 0;
+    for (int idx = 0; idx < n; idx++)
+        total += moves[idx].weight;
+    if (total == 0)
+        return false;
+
+    uint32_t choice = random % total;
+    for (int idx = 0; idx < n; idx++) {
+        if (choice < moves[idx].weight) {
+            move.packed = moves[idx].move;
+            move.captured = moves[idx].captured;
+            return true;
+        }
+        choice -= moves[idx].weight;
+    }
+    return false;
+}
@@ -0,0 +1,73 @@
+/****************************************************************************
+* Opening book.
+*
+* A book is a file of moves for known positions, built by checkers_bookgen
+* and read by mapping the file into memory, so every engine and every
+* process on a machine shares one copy. Each entry is a position key from
+* positionKey(), one move and a weight. Entries are sorted by key so a
+* position's moves are found with a binary search.
+*
+* A multiple jump is a single entry, like any other move.
+*
+* File layout, all integers little endian:
+*   header      TBookHeader
+*   entries     TBookEntry, sorted by key then move
+****************************************************************************/
+#ifndef CHECKERS_BOOK_H
+#define CHECKERS_BOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+
+const uint32_t BookMagic = 0x4B424B43; // "CKBK"
+const uint32_t BookVersion = 2;
+
+struct TBookHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t entries;
+};
+
+struct TBookEntry {
+    uint64_t key;
+    uint16_t move;      // TMove::packed
+    uint16_t weight;    // relative chance of playing the move
+    uint32_t captured;  // TMove::captured
+};
+
+/****************************************************************************
+ * A book file mapped into memory. Lookups are read only and safe from any
+ * number of threads.
+ */
+class TOpeningBook {
+public:
+    TOpeningBook();
+
+    ~TOpeningBook();
+
+    TOpeningBook(const TOpeningBook &) = delete;
+
+    TOpeningBook &operator=(const TOpeningBook &) = delete;
+
+    bool open(const char *path);
+
+    void close();
+
+    bool isOpen() const
+    {
+        return entries != nullptr;
+    }
+
+    int probe(uint64_t key, const TBookEntry **moves) const;
+
+    bool pick(uint64_t key, uint32_t random, TMove &move) const;
+
+private:
+    void *map;
+    size_t length;
+    const TBookEntry *entries;  // nullptr when no file is open
+    size_t count;
+};
+
+#endif // CHECKERS_BOOK_H
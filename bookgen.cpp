@@ -0,0 +1,241 @@
+/****************************************************************************
+* Opening book generator.
+*
+* Builds an opening book by deep search. Starting from the opening position,
+* every move of a position is scored by searching the position after it to
+* a fixed depth. The best few moves, those within a margin of the best
+* score, go in the book with weights that favour the better scores, and
+* the positions after them are searched in turn until the given number of
+* turns. Positions reached by more than one move order are searched once.
+*
+* The positions of each turn are shared between worker threads, each with
+* its own transposition table.
+*
+* Options:
+*   --plies <count>     Turns covered by the book (default 12)
+*   --depth <plies>     Search depth for scoring each move (default 14)
+*   --width <count>     Most book moves for a position (default 2)
+*   --margin <score>    Largest score drop from the best move (default 30)
+*   --threads <count>   Worker threads (default: hardware threads)
+*   --hash <MB>         Transposition table size for each thread (default 16)
+*   --weights <path>    Evaluation weights
+*   --output <path>     File to write (default opening.book)
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "book.h"
+#include "eval.h"
+#include "search.h"
+
+// Weight of the best move of a position
+static const int BestWeight = 100;
+
+struct TBookOptions {
+    int plies;
+    int depth;
+    int width;
+    int margin;
+    int threads;
+    size_t hashMegabytes;
+};
+
+// A position to add to the book
+struct TBookNode {
+    TBoard board;
+    int side;
+    int plies;      // turns played to reach it
+};
+
+struct TScoredMove {
+    TMove move;
+    int score;
+    TBookNode child;
+};
+
+// Work shared by the threads for one turn
+struct TBookWork {
+    const TBookOptions *options;
+    const std::vector<TBookNode> *nodes;
+    std::atomic<size_t> next;
+    std::mutex mutex;               // guards the fields below
+    std::vector<TBookEntry> entries;
+    std::vector<TBookNode> children;
+};
+
+/****************************************************************************
+ * Play a move and find the position after it.
+ * @param node
+ * @param move
+ * @param child - Set to the position after the move
+ */
+static void playMove(const TBookNode &node, TMove move, TBookNode &child)
+{
+    child = node;
+    doMove(child.board, move);
+    child.side ^= 1;
+    child.plies++;
+}
+
+/****************************************************************************
+ * Score every move of a position and choose the book moves.
+ * @param tt
+ * @param options
+ * @param node
+ * @param chosen - Filled with the book moves, best first
+ */
+static void chooseMoves(TTranspositionTable &tt, const TBookOptions &options, const TBookNode &node,
+                        std::vector<TScoredMove> &chosen)
+{
+    TSearchLimits limits = {options.depth, 0, 0, nullptr};
+    TMoveList moves;
+    std::vector<TScoredMove> scored;
+
+    getValidMoves(node.board, node.side, moves);
+    for (TMove move : moves) {
+        TScoredMove s;
+        s.move = move;
+        s.score = 0;
+        playMove(node, move, s.child);
+        if (moves.size() > 1) {
+            TSearchResult result = searchPosition(tt, s.child.board, s.child.side, limits, 1);
+            s.score = -result.score;
+        }
+        scored.push_back(s);
+    }
+    std::stable_sort(scored.begin(), scored.end(), [](const TScoredMove &a, const TScoredMove &b) {
+        return a.score > b.score;
+    });
+
+    chosen.clear();
+    for (const TScoredMove &s : scored) {
+        if (static_cast<int>(chosen.size()) >= options.width || s.score < scored[0].score - options.margin)
+            break;
+        chosen.push_back(s);
+    }
+} // chooseMoves
+
+/****************************************************************************
+ * Worker thread, adds positions of one turn to the book until none are
+ * left.
+ */
+static void worker(TBookWork &work)
+{
+    const TBookOptions &options = *work.options;
+    TTranspositionTable tt(options.hashMegabytes);
+    std::vector<TScoredMove> chosen;
+
+    for (size_t idx = work.next++; idx < work.nodes->size(); idx = work.next++) {
+        const TBookNode &node = (*work.nodes)[idx];
+        chooseMoves(tt, options, node, chosen);
+
+        std::lock_guard<std::mutex> lock(work.mutex);
+        uint64_t key = positionKey(node.board, node.side);
+        for (const TScoredMove &s : chosen) {
+            // Weights fall from BestWeight for the best move toward 1 at the margin
+            int drop = chosen[0].score - s.score;
+            int weight = std::max(1, BestWeight * (options.margin + 1 - drop) / (options.margin + 1));
+            TBookEntry entry = {key, s.move.packed, static_cast<uint16_t>(weight), s.move.captured};
+            work.entries.push_back(entry);
+            if (s.child.plies < options.plies)
+                work.children.push_back(s.child);
+        }
+    }
+} // worker
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--plies count] [--depth plies] [--width count] [--margin score]\n"
+                    "       [--threads count] [--hash MB] [--weights path] [--output path]\n", program);
+}
+
+int main(int argc, char *argv[])
+{
+    TBookOptions options = {12, 14, 2, 30, static_cast<int>(std::thread::hardware_concurrency()), 16};
+    const char *output = "opening.book";
+    const char *weights = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--plies") == 0) {
+            options.plies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0) {
+            options.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--width") == 0) {
+            options.width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--margin") == 0) {
+            options.margin = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--hash") == 0) {
+            options.hashMegabytes = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--weights") == 0) {
+            weights = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0) {
+            output = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.threads < 1)
+        options.threads = 1;
+    if (weights && !loadEvalWeights(weights)) {
+        fprintf(stderr, "Can't read evaluation weights %s\n", weights);
+        return 1;
+    }
+    if (options.width < 1)
+        options.width = 1;
+
+    std::vector<TBookEntry> entries;
+    std::unordered_set<uint64_t> seen;
+    std::vector<TBookNode> nodes = {{newBoard(), Black, 0}};
+    seen.insert(positionKey(newBoard(), Black));
+
+    // Each round adds the positions after one more turn
+    for (int round = 0; !nodes.empty(); round++) {
+        TBookWork work;
+        work.options = &options;
+        work.nodes = &nodes;
+        work.next = 0;
+        std::vector<std::thread> workers;
+        for (int id = 0; id < options.threads; id++)
+            workers.emplace_back(worker, std::ref(work));
+        for (std::thread &t : workers)
+            t.join();
+
+        entries.insert(entries.end(), work.entries.begin(), work.entries.end());
+        fprintf(stderr, "round %2d: %6zu positions %8zu entries\n", round + 1, nodes.size(), entries.size());
+        nodes.clear();
+        for (const TBookNode &child : work.children) {
+            if (seen.insert(positionKey(child.board, child.side)).second)
+                nodes.push_back(child);
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const TBookEntry &a, const TBookEntry &b) {
+        return (a.key != b.key) ? a.key < b.key : a.move < b.move;
+    });
+    FILE *file = fopen(output, "wb");
+    if (!file) {
+        perror(output);
+        return 1;
+    }
+    TBookHeader header = {BookMagic, BookVersion, entries.size()};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries.data(), sizeof(TBookEntry), entries.size(), file);
+    if (fclose(file) != 0) {
+        perror(output);
+        return 1;
+    }
+    return 0;
+} // main
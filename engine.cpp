@@ -0,0 +1,250 @@
+/****************************************************************************
+* Engine: the search resources used to pick moves for games.
+****************************************************************************/
+#include <type_traits>
+#include "engine.h"
+
+// How often a ponder hit checks the caller's stop flag while it waits
+static const int PonderPollMs = 10;
+
+template <class V>
+BasicEngine<V>::BasicEngine(const TEngineConfig &config)
+        : tt(config.hashMegabytes), config(config), ponderStop(false), ponderFinished(false)
+{
+}
+
+template <class V>
+BasicEngine<V>::~BasicEngine()
+{
+    stopPondering();
+}
+
+/****************************************************************************
+ * Change the table size and thread count. Resizing clears the table.
+ * @param newConfig
+ */
+template <class V>
+void BasicEngine<V>::configure(const TEngineConfig &newConfig)
+{
+    stopPondering();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (newConfig.hashMegabytes != config.hashMegabytes)
+        tt.resize(newConfig.hashMegabytes);
+    config = newConfig;
+}
+
+/****************************************************************************
+ * Forget the results of earlier searches.
+ */
+template <class V>
+void BasicEngine<V>::newGame()
+{
+    stopPondering();
+    std::lock_guard<std::mutex> lock(mutex);
+    tt.clear();
+}
+
+/****************************************************************************
+ * Map an endgame tablebase file for the searches to use.
+ * @param path
+ * @return false if the file isn't a tablebase or the variant isn't American
+ *         checkers, the engine then has none.
+ */
+template <class V>
+bool BasicEngine<V>::loadTablebase(const char *path)
+{
+    stopPondering();
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::is_same<V, TAmerican>::value && tablebase.open(path);
+}
+
+/****************************************************************************
+ * Map an opening book file for think() to play from.
+ * @param path
+ * @return false if the file isn't a book or the variant isn't American
+ *         checkers, the engine then has none.
+ */
+template <class V>
+bool BasicEngine<V>::loadBook(const char *path)
+{
+    stopPondering();
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::is_same<V, TAmerican>::value && book.open(path);
+}
+
+/****************************************************************************
+ * Search with a transposition table in a named shared memory segment, see
+ * TTranspositionTable::openShared(), sharing results with the engines of
+ * other processes that use the same name. The table size is the engine's,
+ * unless the segment already exists. A later configure() with a new table
+ * size goes back to a private table.
+ * @param name
+ * @return false if the segment can't be used, the engine keeps its own
+ *         table.
+ */
+template <class V>
+bool BasicEngine<V>::shareTable(const char *name)
+{
+    stopPondering();
+    std::lock_guard<std::mutex> lock(mutex);
+    return tt.openShared(name, config.hashMegabytes, V::VariantId);
+}
+
+/****************************************************************************
+ * Take the move for the game's position from the opening book.
+ * @param book
+ * @param random - Chooses between book moves
+ * @param game
+ * @param result - Set to the book move
+ * @return false if the position isn't in the book or its move isn't legal.
+ */
+static bool pickBookMove(const TOpeningBook &book, uint32_t random, const Game &game, TSearchResult &result)
+{
+    TMove move;
+    if (!book.pick(positionKey(game.board(), game.sideToMove()), random, move))
+        return false;
+    TMoveList moves;
+    game.legalMoves(moves);
+    for (TMove legal : moves) {
+        if (legal == move) {
+            result = {};
+            result.move = move;
+            result.pv[0] = move;
+            result.pvLength = 1;
+            result.bookMove = true;
+            return true;
+        }
+    }
+    return false;
+} // pickBookMove
+
+// The book only holds American positions
+template <class V>
+static bool pickBookMove(const TOpeningBook &, uint32_t, const BasicGame<V> &, TSearchResultOf<V> &)
+{
+    return false;
+}
+
+/****************************************************************************
+ * Search for the best move for the side to move in the game, or take it
+ * from the opening book when the position is there. When the game reached
+ * the position being pondered the ponder search carries on until the
+ * limits are met, counting the time since pondering began, otherwise it is
+ * stopped.
+ * @param game
+ * @param limits
+ * @return The search result, pvLength is 0 when the game has no moves.
+ */
+template <class V>
+TSearchResultOf<V> BasicEngine<V>::think(const BasicGame<V> &game, const TSearchLimits &limits)
+{
+    TSearchResultOf<V> result;
+    if (ponderHit(game, limits, result))
+        return result;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pickBookMove(book, static_cast<uint32_t>(bookRandom()), game, result))
+        return result;
+    return searchPosition(tt, game.board(), game.sideToMove(), limits, config.threads, &tablebase);
+}
+
+/****************************************************************************
+ * Start searching, on a thread of its own, the position after the reply
+ * the engine expects. Any earlier pondering is stopped.
+ * @param game - The game with the opponent to move
+ * @param reply - The opponent's expected move, such as the second move of
+ *                the principal variation of the engine's move
+ * @param limits - Limits the next think() will be given, the depth and
+ *                 node limits apply to the ponder search
+ * @return false if there is nothing to ponder: the reply isn't legal, the
+ *         game would be over, or the position is in the opening book.
+ */
+template <class V>
+bool BasicEngine<V>::ponder(const BasicGame<V> &game, TMoveOf<V> reply, const TSearchLimits &limits)
+{
+    stopPondering();
+    BasicGame<V> next = game;
+    if (!next.play(reply) || next.result() != GameOngoing)
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const TBookEntry *entries;
+        if (book.probe(positionKey(next.board(), next.sideToMove()), &entries) > 0)
+            return false; // think() plays from the book at once
+    }
+
+    ponderGame = next;
+    ponderStop = false;
+    ponderFinished = false;
+    ponderStart = std::chrono::steady_clock::now();
+    TSearchLimits ponderLimits = {limits.depth, 0, limits.nodes, &ponderStop};
+    ponderThread = std::thread(&BasicEngine<V>::ponderSearch, this, ponderLimits);
+    return true;
+} // ponder
+
+/****************************************************************************
+ * Stop pondering and wait for the search to end. Its transposition table
+ * entries stay for later searches.
+ */
+template <class V>
+void BasicEngine<V>::stopPondering()
+{
+    if (!ponderThread.joinable())
+        return;
+    ponderStop = true;
+    ponderThread.join();
+}
+
+/****************************************************************************
+ * Ponder thread.
+ */
+template <class V>
+void BasicEngine<V>::ponderSearch(TSearchLimits limits)
+{
+    TSearchResultOf<V> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        result = searchPosition(tt, ponderGame.board(), ponderGame.sideToMove(), limits, config.threads,
+                                &tablebase);
+    }
+    std::lock_guard<std::mutex> lock(ponderMutex);
+    ponderResult = result;
+    ponderFinished = true;
+    ponderDone.notify_all();
+}
+
+/****************************************************************************
+ * Finish pondering for think().
+ * @param game
+ * @param limits
+ * @param result - Set to the ponder search's result on a hit
+ * @return true if the game reached the pondered position. Otherwise any
+ *         pondering is stopped.
+ */
+template <class V>
+bool BasicEngine<V>::ponderHit(const BasicGame<V> &game, const TSearchLimits &limits, TSearchResultOf<V> &result)
+{
+    if (!ponderThread.joinable())
+        return false;
+    if (game.history().size() != ponderGame.history().size() ||
+        positionKey(game.board(), game.sideToMove()) != positionKey(ponderGame.board(), ponderGame.sideToMove())) {
+        stopPondering();
+        return false;
+    }
+
+    {
+        // The time spent pondering counts toward the time limit
+        std::chrono::milliseconds limit(limits.timeMs);
+        std::unique_lock<std::mutex> lock(ponderMutex);
+        while (!ponderFinished && (!limits.timeMs || std::chrono::steady_clock::now() - ponderStart < limit) &&
+               !(limits.stop && limits.stop->load()))
+            ponderDone.wait_for(lock, std::chrono::milliseconds(PonderPollMs));
+    }
+    stopPondering();
+    result = ponderResult;
+    result.ponderHit = true;
+    return true;
+} // ponderHit
+
+template class BasicEngine<TAmerican>;
+template class BasicEngine<TInternational>;
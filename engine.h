@@ -0,0 +1,96 @@
+/****************************************************************************
+* Engine: the search resources used to pick moves for games.
+*
+* An Engine owns a transposition table, which may be shared with other
+* processes, a search thread count and
+* optionally an endgame tablebase and an opening book. Positions in the
+* book are answered from it without a search. Its
+* methods may be called from any thread; searches on one Engine run one at a
+* time, searches on different Engines run in parallel. A server can give
+* each game its own Engine or share a few Engines between many games.
+*
+* After its move an Engine can ponder: search the position after the reply
+* it expects, on its own thread, while the opponent thinks. If the reply is
+* played the next think() carries on from that search, otherwise the search
+* is stopped and only its transposition table entries are kept. Pondering
+* suits an Engine playing a single game.
+*
+* An engine is a template on the rules variant, see board.h, and Engine is
+* the American checkers engine. The tablebase and opening book only hold
+* American positions, engines for other variants never load them.
+****************************************************************************/
+#ifndef CHECKERS_ENGINE_H
+#define CHECKERS_ENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "book.h"
+#include "game.h"
+#include "search.h"
+#include "tablebase.h"
+#include "tt.h"
+
+struct TEngineConfig {
+    size_t hashMegabytes;   // transposition table size
+    int threads;            // search threads for each search
+};
+
+const TEngineConfig DefaultEngineConfig = {16, 1};
+
+template <class V>
+class BasicEngine {
+public:
+    explicit BasicEngine(const TEngineConfig &config = DefaultEngineConfig);
+
+    ~BasicEngine();
+
+    BasicEngine(const BasicEngine &) = delete;
+
+    BasicEngine &operator=(const BasicEngine &) = delete;
+
+    void configure(const TEngineConfig &config);
+
+    void newGame();
+
+    bool loadTablebase(const char *path);
+
+    bool loadBook(const char *path);
+
+    bool shareTable(const char *name);
+
+    TSearchResultOf<V> think(const BasicGame<V> &game, const TSearchLimits &limits);
+
+    bool ponder(const BasicGame<V> &game, TMoveOf<V> reply, const TSearchLimits &limits);
+
+    void stopPondering();
+
+private:
+    void ponderSearch(TSearchLimits limits);
+
+    bool ponderHit(const BasicGame<V> &game, const TSearchLimits &limits, TSearchResultOf<V> &result);
+
+    std::mutex mutex;
+    TTranspositionTable tt;
+    TTablebase tablebase;
+    TOpeningBook book;
+    std::minstd_rand bookRandom;    // chooses between book moves
+    TEngineConfig config;
+
+    // Pondering, used by the thread that calls ponder() and think()
+    std::thread ponderThread;
+    std::atomic<bool> ponderStop;
+    BasicGame<V> ponderGame;                // position being pondered
+    std::chrono::steady_clock::time_point ponderStart;
+    std::mutex ponderMutex;                 // guards the fields below
+    std::condition_variable ponderDone;
+    bool ponderFinished;                    // the search ended by itself
+    TSearchResultOf<V> ponderResult;
+};
+
+typedef BasicEngine<TAmerican> Engine;
+
+#endif // CHECKERS_ENGINE_H
@@ -0,0 +1,274 @@
+/****************************************************************************
+* Static evaluation of a board.
+****************************************************************************/
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "eval.h"
+
+// The vector batch evaluation needs GCC or Clang on x86 for the target
+// attribute and __builtin_cpu_supports().
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+#define EVAL_X86
+#include <immintrin.h>
+#endif
+
+// Weights in use, see setEvalWeights()
+static TEvalWeights activeWeights = DefaultEvalWeights;
+
+// Names of the weights in a weights file
+static const struct {
+    const char *name;
+    int TEvalWeights::*weight;
+} WeightNames[] = {
+    {"man", &TEvalWeights::man},
+    {"edge_man", &TEvalWeights::edgeMan},
+    {"king", &TEvalWeights::king},
+    {"win", &TEvalWeights::win},
+};
+
+/****************************************************************************
+ * Get a score for the board based on the difference between the side's
+ * checkers and the opponent's checkers.
+ * @param board
+ * @param side - Side the score is for
+ * @return Score for the side, higher is better. The negated score is the
+ *         score for the opponent.
+ */
+template <class V>
+int getScore(const TBoardOf<V> &board, int side)
+{
+    if (board.pieces[side ^ 1] == 0)
+        return activeWeights.win; // hi score
+    if (board.pieces[side] == 0)
+        return -activeWeights.win;
+    // Kept up to date by makeMove(), see PieceValues
+    return board.material[side] - board.material[side ^ 1];
+} // getScore
+
+template int getScore(const TBoard &board, int side);
+template int getScore(const TBoardOf<TInternational> &board, int side);
+
+const TEvalWeights &evalWeights()
+{
+    return activeWeights;
+}
+
+/****************************************************************************
+ * Use a new set of weights. Not thread safe, call it before making any
+ * boards or starting any searches.
+ * @param weights
+ */
+void setEvalWeights(const TEvalWeights &weights)
+{
+    activeWeights = weights;
+    PieceValues<TAmerican> = makePieceValues<TAmerican>(weights);
+    PieceValues<TInternational> = makePieceValues<TInternational>(weights);
+}
+
+/****************************************************************************
+ * Read weights from a file of "name value" lines. Blank lines and lines
+ * starting with # are skipped. Weights the file doesn't name keep their
+ * value in weights.
+ * @param path
+ * @param weights
+ * @return false if the file can't be read, or has an unknown name or a
+ *         value outside 1 to MaxEvalWeight.
+ */
+bool readEvalWeights(const char *path, TEvalWeights &weights)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+
+    TEvalWeights read = weights;
+    char line[128];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        char name[32];
+        int value;
+        char extra;
+        if (sscanf(line, " %c", &extra) != 1 || extra == '#')
+            continue; // blank or comment
+        ok = false;
+        if (sscanf(line, "%31s %d %c", name, &value, &extra) != 2 || value < 1 || value > MaxEvalWeight)
+            break;
+        for (const auto &entry : WeightNames) {
+            if (strcmp(name, entry.name) == 0) {
+                read.*entry.weight = value;
+                ok = true;
+            }
+        }
+    }
+    fclose(file);
+    if (ok)
+        weights = read;
+    return ok;
+} // readEvalWeights
+
+/****************************************************************************
+ * Write weights in the form readEvalWeights() reads.
+ * @param path
+ * @param weights
+ * @return false if the file can't be written.
+ */
+bool writeEvalWeights(const char *path, const TEvalWeights &weights)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+    fprintf(file, "# Checkers evaluation weights, in hundredths of a man\n");
+    for (const auto &entry : WeightNames)
+        fprintf(file, "%s %d\n", entry.name, weights.*entry.weight);
+    return fclose(file) == 0;
+}
+
+/****************************************************************************
+ * Read weights from a file and use them, see setEvalWeights().
+ * @param path
+ * @return false if the file can't be read, leaving the weights unchanged.
+ */
+bool loadEvalWeights(const char *path)
+{
+    TEvalWeights loaded = DefaultEvalWeights;
+    if (!readEvalWeights(path, loaded))
+        return false;
+    setEvalWeights(loaded);
+    return true;
+}
+
+static void getScoresScalar(const TBoard *boards, const int *sides, int *scores, int count)
+{
+    for (int idx = 0; idx < count; idx++)
+        scores[idx] = getScore(boards[idx], sides[idx]);
+}
+
+#ifdef EVAL_X86
+
+/****************************************************************************
+ * Score four boards at a time. SSE2 has no gather, so the fields are loaded
+ * one board at a time and only the combine is vectorized.
+ */
+static void getScoresSSE2(const TBoard *boards, const int *sides, int *scores, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i win = _mm_set1_epi32(activeWeights.win);
+    const __m128i loss = _mm_set1_epi32(-activeWeights.win);
+    int idx = 0;
+
+    for (; idx + 4 <= count; idx += 4) {
+        const TBoard *b = boards + idx;
+        __m128i black = _mm_setr_epi32(static_cast<int>(b[0].pieces[Black]), static_cast<int>(b[1].pieces[Black]),
+                                       static_cast<int>(b[2].pieces[Black]), static_cast<int>(b[3].pieces[Black]));
+        __m128i red = _mm_setr_epi32(static_cast<int>(b[0].pieces[Red]), static_cast<int>(b[1].pieces[Red]),
+                                     static_cast<int>(b[2].pieces[Red]), static_cast<int>(b[3].pieces[Red]));
+        __m128i score = _mm_setr_epi32(b[0].material[Black] - b[0].material[Red],
+                                       b[1].material[Black] - b[1].material[Red],
+                                       b[2].material[Black] - b[2].material[Red],
+                                       b[3].material[Black] - b[3].material[Red]);
+        // All ones for red, whose score is the negated black score
+        __m128i isRed = _mm_sub_epi32(zero, _mm_loadu_si128(reinterpret_cast<const __m128i *>(sides + idx)));
+        score = _mm_sub_epi32(_mm_xor_si128(score, isRed), isRed);
+
+        __m128i blackGone = _mm_cmpeq_epi32(black, zero);
+        __m128i redGone = _mm_cmpeq_epi32(red, zero);
+        __m128i ownGone = _mm_or_si128(_mm_and_si128(isRed, redGone), _mm_andnot_si128(isRed, blackGone));
+        __m128i oppGone = _mm_or_si128(_mm_and_si128(isRed, blackGone), _mm_andnot_si128(isRed, redGone));
+        score = _mm_or_si128(_mm_and_si128(ownGone, loss), _mm_andnot_si128(ownGone, score));
+        score = _mm_or_si128(_mm_and_si128(oppGone, win), _mm_andnot_si128(oppGone, score));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(scores + idx), score);
+    }
+    getScoresScalar(boards + idx, sides + idx, scores + idx, count - idx);
+} // getScoresSSE2
+
+/****************************************************************************
+ * Score eight boards at a time, gathering the fields of eight boards into
+ * one register each.
+ */
+__attribute__((target("avx2")))
+static void getScoresAVX2(const TBoard *boards, const int *sides, int *scores, int count)
+{
+    const int stride = sizeof(TBoard) / sizeof(int);
+    const int piecesField = offsetof(TBoard, pieces) / sizeof(int);
+    const int materialField = offsetof(TBoard, material) / sizeof(int);
+    const __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i win = _mm256_set1_epi32(activeWeights.win);
+    const __m256i loss = _mm256_set1_epi32(-activeWeights.win);
+    int idx = 0;
+
+    for (; idx + 8 <= count; idx += 8) {
+        const int *base = reinterpret_cast<const int *>(boards + idx);
+        __m256i black = _mm256_i32gather_epi32(base + piecesField + Black, lanes, 4);
+        __m256i red = _mm256_i32gather_epi32(base + piecesField + Red, lanes, 4);
+        __m256i score = _mm256_sub_epi32(_mm256_i32gather_epi32(base + materialField + Black, lanes, 4),
+                                         _mm256_i32gather_epi32(base + materialField + Red, lanes, 4));
+        __m256i isRed = _mm256_sub_epi32(zero, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(sides + idx)));
+        score = _mm256_sub_epi32(_mm256_xor_si256(score, isRed), isRed);
+
+        __m256i blackGone = _mm256_cmpeq_epi32(black, zero);
+        __m256i redGone = _mm256_cmpeq_epi32(red, zero);
+        __m256i ownGone = _mm256_blendv_epi8(blackGone, redGone, isRed);
+        __m256i oppGone = _mm256_blendv_epi8(redGone, blackGone, isRed);
+        score = _mm256_blendv_epi8(score, loss, ownGone);
+        score = _mm256_blendv_epi8(score, win, oppGone);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(scores + idx), score);
+    }
+    getScoresScalar(boards + idx, sides + idx, scores + idx, count - idx);
+} // getScoresAVX2
+
+#endif // EVAL_X86
+
+/****************************************************************************
+ * The fastest batch evaluation this processor supports, checked once.
+ */
+TEvalBackend bestEvalBackend()
+{
+#ifdef EVAL_X86
+    static const TEvalBackend best = __builtin_cpu_supports("avx2") ? EvalAVX2 : EvalSSE2;
+    return best;
+#else
+    return EvalScalar;
+#endif
+}
+
+const char *evalBackendName(TEvalBackend backend)
+{
+    static const char *const names[] = {"scalar", "sse2", "avx2"};
+    return names[backend];
+}
+
+/****************************************************************************
+ * Score a batch of boards, the same as calling getScore() on each.
+ * @param boards
+ * @param sides - Side each score is for, Black or Red
+ * @param scores - Filled with the score of each board
+ * @param count
+ */
+void getScores(const TBoard *boards, const int *sides, int *scores, int count)
+{
+    getScores(boards, sides, scores, count, bestEvalBackend());
+}
+
+/****************************************************************************
+ * Score a batch of boards with a given backend, for comparing them. A
+ * backend the processor doesn't support falls back to the best one it does.
+ */
+void getScores(const TBoard *boards, const int *sides, int *scores, int count, TEvalBackend backend)
+{
+    if (backend > bestEvalBackend())
+        backend = bestEvalBackend();
+    switch (backend) {
+#ifdef EVAL_X86
+        case EvalAVX2:
+            getScoresAVX2(boards, sides, scores, count);
+            break;
+        case EvalSSE2:
+            getScoresSSE2(boards, sides, scores, count);
+            break;
+#endif
+        default:
+            getScoresScalar(boards, sides, scores, count);
+            break;
+    }
+}
@@ -0,0 +1,44 @@
+/****************************************************************************
+* Static evaluation of a board.
+*
+* getScore() scores one board for the search. getScores() scores a batch of
+* boards at once for bulk analysis, using AVX2 or SSE2 when the processor
+* has them and plain code otherwise. Both give the same scores.
+*
+* The score is the material difference from TBoard::material, using the
+* piece values built from a set of weights. A program that loads its own
+* weights with loadEvalWeights() must do so at startup, before it makes any
+* boards, as boards keep the material they were made with.
+****************************************************************************/
+#ifndef CHECKERS_EVAL_H
+#define CHECKERS_EVAL_H
+
+#include "board.h"
+
+// Ways of evaluating a batch, from slowest to fastest
+enum TEvalBackend {
+    EvalScalar, EvalSSE2, EvalAVX2
+};
+
+template <class V>
+int getScore(const TBoardOf<V> &board, int side);
+
+const TEvalWeights &evalWeights();
+
+void setEvalWeights(const TEvalWeights &weights);
+
+bool readEvalWeights(const char *path, TEvalWeights &weights);
+
+bool writeEvalWeights(const char *path, const TEvalWeights &weights);
+
+bool loadEvalWeights(const char *path);
+
+TEvalBackend bestEvalBackend();
+
+const char *evalBackendName(TEvalBackend backend);
+
+void getScores(const TBoard *boards, const int *sides, int *scores, int count);
+
+void getScores(const TBoard *boards, const int *sides, int *scores, int count, TEvalBackend backend);
+
+#endif // CHECKERS_EVAL_H
@@ -0,0 +1,104 @@
+/****************************************************************************
+* A game in progress.
+****************************************************************************/
+#include "game.h"
+
+template <class V>
+BasicGame<V>::BasicGame()
+        : BasicGame(newBoard<V>(), V::FirstSide)
+{
+}
+
+template <class V>
+BasicGame<V>::BasicGame(const TBoardOf<V> &board, int side)
+        : position(board), side(side), quietPlies(0)
+{
+    keys.push_back(positionKey(position, side));
+}
+
+/****************************************************************************
+ * Get the moves the side to move may play.
+ * @param list - Cleared and filled with the moves
+ */
+template <class V>
+void BasicGame<V>::legalMoves(TMoveListOf<V> &list) const
+{
+    getValidMoves(position, side, list);
+}
+
+/****************************************************************************
+ * Play a move for the side to move.
+ * @param move
+ * @return false if the move isn't legal, the game is unchanged.
+ */
+template <class V>
+bool BasicGame<V>::play(TMoveOf<V> move)
+{
+    TMoveListOf<V> list;
+    bool legal = false;
+
+    legalMoves(list);
+    for (TMoveOf<V> m : list) {
+        if (m == move)
+            legal = true;
+    }
+    if (!legal)
+        return false;
+
+    bool manMove = !(position.kings & squareMask<V>(move.from()));
+    moves.push_back(move);
+    doMove(position, move);
+    side ^= 1;
+    if (move.isJump() || manMove) {
+        // The earlier positions can't come back
+        quietPlies = 0;
+        keys.clear();
+    } else {
+        quietPlies++;
+    }
+    keys.push_back(positionKey(position, side));
+    return true;
+} // play
+
+/****************************************************************************
+ * Play a move written in PDN notation, such as "11-15" or "15x22x29" for a
+ * multiple jump, see parseMove().
+ * @param text
+ * @return false if the text isn't a legal move, the game is unchanged.
+ */
+template <class V>
+bool BasicGame<V>::playText(const char *text)
+{
+    TMoveListOf<V> list;
+    TMoveOf<V> move;
+
+    legalMoves(list);
+    return parseMove(text, list, move) && play(move);
+}
+
+/****************************************************************************
+ * Check whether the game is over. A side with no moves has lost. The game
+ * is drawn when the same position comes up a third time or after DrawPlies
+ * plies of king moves.
+ * @return
+ */
+template <class V>
+TGameResult BasicGame<V>::result() const
+{
+    TMoveListOf<V> list;
+
+    legalMoves(list);
+    if (list.size() == 0)
+        return (side == Black) ? RedWins : BlackWins;
+    if (quietPlies >= DrawPlies)
+        return GameDrawn;
+    int repeats = 0;
+    for (uint64_t key : keys) {
+        if (key == keys.back())
+            repeats++;
+    }
+    return (repeats >= 3) ? GameDrawn : GameOngoing;
+} // result
+
+template class BasicGame<TAmerican>;
+template class BasicGame<TInternational>;
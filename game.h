@@ -0,0 +1,65 @@
+/****************************************************************************
+* A game in progress: the position, the side to move, the moves played so
+* far and the rules for ending the game.
+*
+* A game is a template on the rules variant, see board.h. Game is an
+* American checkers game.
+*
+* A Game holds no references to anything outside itself, so any number of
+* games can be played at once. A single Game is not locked and should only
+* be used by one thread at a time.
+****************************************************************************/
+#ifndef CHECKERS_GAME_H
+#define CHECKERS_GAME_H
+
+#include <vector>
+#include "board.h"
+
+// Plies without a jump or a man moving before the game is drawn
+const int DrawPlies = 80;
+
+enum TGameResult {
+    GameOngoing, BlackWins, RedWins, GameDrawn
+};
+
+template <class V>
+class BasicGame {
+public:
+    BasicGame();
+
+    BasicGame(const TBoardOf<V> &board, int side);
+
+    const TBoardOf<V> &board() const
+    {
+        return position;
+    }
+
+    int sideToMove() const
+    {
+        return side;
+    }
+
+    const std::vector<TMoveOf<V>> &history() const
+    {
+        return moves;
+    }
+
+    void legalMoves(TMoveListOf<V> &list) const;
+
+    bool play(TMoveOf<V> move);
+
+    bool playText(const char *text);
+
+    TGameResult result() const;
+
+private:
+    TBoardOf<V> position;
+    int side;
+    int quietPlies;                 // plies since the last jump or man move
+    std::vector<TMoveOf<V>> moves;
+    std::vector<uint64_t> keys;     // positions since the last jump or man move
+};
+
+typedef BasicGame<TAmerican> Game;
+
+#endif // CHECKERS_GAME_H
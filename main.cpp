@@ -9,8 +9,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <vector>
+#include <chrono>
 #include <exception>
+#include "engine.h"
+#include "eval.h"
+#include "perft.h"
 
 // Uncomment the following if building on linux.
 #define LINUX_APP
@@ -25,22 +28,11 @@
 #endif
 
 
-const int Rows = 8;
-const int Cols = 8;
-static const int BoardSize = 65;
-const char NewBoard[BoardSize] =
-        " b b b bb b b b  b b b b        "
-        "        r r r r  r r r rr r r r ";
-// MCF Debug
-//       12345678   12345678   12345678   12345678
-//        "   b    " "      b " "        " "    r r "
-//        "     r  " "      r " "        " "        ";
-
-static char *main_board = nullptr;
-
 static char userColor = 'b';
-static char currentColor = 'b';
-static char compColor = 'r';
+// Search statistics of each computer move go here, nullptr for none
+static FILE *statsStream = nullptr;
+// Search the expected reply while the user thinks
+static bool pondering = true;
 
 #ifdef LINUX_APP
 
@@ -50,169 +42,223 @@ int getche(void);
 
 #endif
 
-struct TLocation {
-    int row, col;
-
-    bool operator==(const TLocation &a) const
-    {
-        return (row == a.row && col == a.col);
-    }
-};
-
-struct TMove {
-    TLocation from, to;
-    int score;
-
-    bool operator==(const TMove &a) const
-    {
-        return (from == a.from && to == a.to);
-    }
-};
-
 struct TChecker {
     char color;
     TLocation loc;
 };
 
-static TLocation jumpPos;
-static bool jumped;
-
-bool RunGame();
-
-bool computerMove(char *board);
-
-bool humanMove(char *board);
+bool RunGame(Engine &engine, const TSearchLimits &limits);
 
-void doMove(char *board, TMove move);
+bool computerMove(Game &game, Engine &engine, const TSearchLimits &limits);
 
-void checkKings(char *board);
+bool humanMove(Game &game);
 
 TLocation getLocation();
 
-int scoreMoves(char *board, std::vector<TMove *> *moves, char color);
+void showBoard(const TBoard &board);
 
-std::vector<TMove *> *copyMoveList(std::vector<TMove *> *moves);
+template <class V>
+void runPerft(const char *fen, int depth, bool divide);
 
-void showBoard(char *board);
-
-std::vector<TMove *> *getValidMoves(char *board, char color);
-
-int getScore(char *board);
-bool checkMove(const char *board, std::vector<TMove *> *moves, int rowIdx, int colIdx,
-               int r_plus, int c_plus, bool jumps);
-bool checkJump(const char *board, std::vector<TMove *> *moves,
-               int rowIdx, int colIdx, int r_plus, int c_plus, bool *jumps);
-void clearMoves(std::vector<TMove *> *moves);
-void checkerMoves(const char *board, std::vector<TMove *> *moves, int rowIdx, int colIdx, bool &jumps);
-bool doChecks(const char *board, std::vector<TMove *> *moves, int rowIdx, int colIdx, bool &jumps, int r_plus,
-              int c_plus);
-
-int main()
+/****************************************************************************
+ * Options:
+ *   --hash <MB>       Transposition table size in megabytes
+ *   --shared-hash <name> Share the transposition table with other processes
+ *                     through the named shared memory segment
+ *   --depth <plies>   Deepest search iteration
+ *   --movetime <ms>   Time for each computer move, 0 for no limit
+ *   --nodes <count>   Nodes for each computer move, 0 for no limit
+ *   --threads <count> Search threads
+ *   --tablebase <path> Endgame tablebase built by checkers_tbgen
+ *   --book <path>     Opening book built by checkers_bookgen
+ *   --weights <path>  Evaluation weights written by checkers_tune
+ *   --stats <path>    Write a JSON line of search statistics for each
+ *                     computer move to the file, - for stderr
+ *   --no-ponder       Don't search while the user thinks
+ *   --perft <depth>   Count the positions to a depth and exit
+ *   --divide          With --perft, show the count below each move
+ *   --fen <position>  With --perft, the position to count from
+ *   --variant <name>  With --perft, american (the default) or international
+ */
+int main(int argc, char *argv[])
 {
+    TEngineConfig config = DefaultEngineConfig;
+    TSearchLimits limits = {0, 1000, 0, nullptr};
+    int perftDepth = 0;
+    bool divide = false;
+    const char *fen = nullptr;
+    bool international = false;
+    const char *sharedHash = nullptr;
+    const char *tablebase = nullptr;
+    const char *book = nullptr;
+    const char *stats = nullptr;
+    const char *weights = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+            config.hashMegabytes = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--shared-hash") == 0 && i + 1 < argc) {
+            sharedHash = argv[++i];
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            limits.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--movetime") == 0 && i + 1 < argc) {
+            limits.timeMs = strtoll(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) {
+            limits.nodes = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            config.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tablebase") == 0 && i + 1 < argc) {
+            tablebase = argv[++i];
+        } else if (strcmp(argv[i], "--book") == 0 && i + 1 < argc) {
+            book = argv[++i];
+        } else if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+            weights = argv[++i];
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            stats = argv[++i];
+        } else if (strcmp(argv[i], "--no-ponder") == 0) {
+            pondering = false;
+        } else if (strcmp(argv[i], "--perft") == 0 && i + 1 < argc) {
+            perftDepth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--divide") == 0) {
+            divide = true;
+        } else if (strcmp(argv[i], "--fen") == 0 && i + 1 < argc) {
+            fen = argv[++i];
+        } else if (strcmp(argv[i], "--variant") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "american") == 0 || strcmp(argv[i + 1], "international") == 0)) {
+            international = (strcmp(argv[++i], "international") == 0);
+        } else {
+            fprintf(stderr, "usage: %s [--hash MB] [--shared-hash name] [--depth plies] [--movetime ms] [--nodes count]"
+                            " [--threads count]\n"
+                            "       [--tablebase path] [--book path] [--weights path] [--stats path] [--no-ponder]\n"
+                            "       %s --perft depth [--divide] [--fen position] [--variant american|international]\n",
+                    argv[0], argv[0]);
+            return 1;
+        }
+    }
+    if (weights && !loadEvalWeights(weights)) {
+        fprintf(stderr, "Can't read evaluation weights %s\n", weights);
+        return 1;
+    }
+    if (stats) {
+        statsStream = (strcmp(stats, "-") == 0) ? stderr : fopen(stats, "a");
+        if (!statsStream) {
+            perror(stats);
+            return 1;
+        }
+    }
+    if (perftDepth > 0) {
+        if (international)
+            runPerft<TInternational>(fen, perftDepth, divide);
+        else
+            runPerft<TAmerican>(fen, perftDepth, divide);
+        return 0;
+    }
+    Engine engine(config);
+    if (sharedHash && !engine.shareTable(sharedHash))
+        fprintf(stderr, "Can't open shared hash %s, using a private table\n", sharedHash);
+    if (tablebase && !engine.loadTablebase(tablebase))
+        fprintf(stderr, "Can't read tablebase %s, playing without it\n", tablebase);
+    if (book && !engine.loadBook(book))
+        fprintf(stderr, "Can't read opening book %s, playing without it\n", book);
     printf("  Checkers");
-    showBoard(const_cast<char *>(NewBoard));
-    RunGame();
+    showBoard(newBoard());
+    RunGame(engine, limits);
     return 0;
 }
 
 /****************************************************************************
  * Main game loop
+ * @param engine
+ * @param limits - Search limits for the computer's moves
  * @return
  */
-bool RunGame()
+bool RunGame(Engine &engine, const TSearchLimits &limits)
 {
     bool gameOver = false;
+    Game game;
 
-    main_board = strdup(NewBoard);
     while (!gameOver) {
-        if (userColor == currentColor) {
-            gameOver = !humanMove(main_board);
+        if (sideOf(userColor) == game.sideToMove()) {
+            gameOver = !humanMove(game);
             if (gameOver)
                 printf("Sorry, you have been defeated.");
         } else {
-            gameOver = !computerMove(main_board);
+            gameOver = !computerMove(game, engine, limits);
             if (gameOver)
                 printf("Congratulations! You have defeated the computer.");
         }
+        if (!gameOver && game.result() == GameDrawn) {
+            printf("The game is a draw.");
+            gameOver = true;
+        }
 
-        showBoard(main_board);
+        showBoard(game.board());
     } // end while
     return gameOver;
 } // end run game
 
 /****************************************************************************
- * Its the computers turn!
- * @param board
- * @return
+ * Its the computers turn! Once it has moved the engine ponders the reply
+ * it expects.
+ * @param game
+ * @param engine
+ * @param limits
+ * @return false when the computer has no moves.
  */
-bool computerMove(char *board)
+bool computerMove(Game &game, Engine &engine, const TSearchLimits &limits)
 {
-    bool moveOk = true;
-    bool done = false;
+    TMoveList moveList;
 
-    std::vector<TMove *> *moveList = getValidMoves(board, currentColor);
-    while (!done) {
-        if (moveList->size() < 1) // no moves?
-        {
-            moveOk = false;
-            done = true;
-        } else {
-            int idx = scoreMoves(board, moveList, compColor); //rand() % moveList->size();
-            if (idx < 0)
-                idx = 0;
-            if (idx >= moveList->size())
-                idx = moveList->size() - 1;
-            {
-                // MCF Debug print list & scores
-                for (TMove *obj : *moveList)
-                    printf("From:%d,%d  To:%d,%d Score = %d\n",
-                           obj->from.row, obj->from.col, obj->to.row, obj->to.col, obj->score);
-                TMove move = *(*moveList)[idx];
-                printf("Selected move, from:%d,%d  to:%d,%d Score = %d\n",
-                       move.from.row, move.from.col, move.to.row, move.to.col, move.score);
-
-                doMove(board, move);
-                clearMoves(moveList);
-                if (jumped) {
-                    bool jumps = false;
-                    // Look for double jump
-                    jumped = false;
-                    for (int r_plus = -1; r_plus <= 1; r_plus += 2)
-                        for (int c_plus = -1; c_plus <= 1; c_plus += 2)
-                            checkJump(board, moveList, jumpPos.row - 1, jumpPos.col - 1,
-                                      r_plus, c_plus, &jumps);
-                }
-                // Found move in the valid move list
-                if (moveList->size() < 1)  // No more jumps found
-                {
-                    done = true;
-                    moveOk = true;
-                }
-            }
-        }
-    } // end while not done loop.
-    currentColor = userColor; // Human's turn
-    clearMoves(moveList);
-    delete (moveList);
-    return moveOk;
+    game.legalMoves(moveList);
+    if (moveList.size() < 1) // no moves?
+        return false;
+
+    TSearchResult result = engine.think(game, limits);
+    if (statsStream) {
+        char fields[64];
+        snprintf(fields, sizeof(fields), "\"ply\":%d", static_cast<int>(game.history().size()));
+        writeSearchStats(statsStream, fields, result);
+    }
+    // MCF Debug print selected move & score
+    TMove move = result.move;
+    TLocation from = squareToLocation(move.from());
+    TLocation to = squareToLocation(move.to());
+    char text[MoveTextSize];
+    moveToText(move, text);
+    if (result.bookMove)
+        printf("Book move %s, from:%d,%d  to:%d,%d\n", text, from.row, from.col, to.row, to.col);
+    else
+        printf("Selected move %s, from:%d,%d  to:%d,%d Score = %d Depth = %d Nodes = %llu Time = %lldms%s\n",
+               text, from.row, from.col, to.row, to.col, result.score, result.depth,
+               static_cast<unsigned long long>(result.nodes), static_cast<long long>(result.timeMs),
+               result.ponderHit ? " (ponder hit)" : "");
+    game.play(move);
+
+    if (pondering && result.pvLength > 1)
+        engine.ponder(game, result.pv[1], limits);
+    return true;
 } // computerMove
 
 /****************************************************************************
- * Get move from the user
- * @param board
+ * Get move from the user. A multiple jump is entered one hop at a time.
+ * @param game
  * @return true for valid move. False means no valid moves.
  */
-bool humanMove(char *board)
+bool humanMove(Game &game)
 {
     bool moveOk = false;
     bool anotherJump = false;
-    TMove move;
+    TLocation from, to;
     bool done = false;
     bool invalid = false;
+    int start = NoSquare;   // square the moving piece started on
+    uint32_t taken = 0;     // pieces jumped by the hops so far
+    TBoard shown = game.board();
+    TMoveList moveList;
 
-    std::vector<TMove *> *moveList = getValidMoves(board, userColor);
+    game.legalMoves(moveList);
 
-    if (moveList->size() < 1) // no moves?
+    if (moveList.size() < 1) // no moves?
     {
         done = true;
     }
@@ -220,42 +266,53 @@ bool humanMove(char *board)
     // printf("Number of valid moves: %d \n", (int)moveList->size());
     while (!done) {
         // MCF Debug
-        for (TMove *obj : *moveList)
-            printf("From:%d,%d  To:%d,%d\n", obj->from.row, obj->from.col, obj->to.row, obj->to.col);
+        for (TMove obj : moveList) {
+            TLocation objFrom = squareToLocation(obj.from());
+            TLocation objTo = squareToLocation(obj.to());
+            printf("From:%d,%d  To:%d,%d\n", objFrom.row, objFrom.col, objTo.row, objTo.col);
+        }
         if (!anotherJump) // just need to location
         {
             printf("\nFrom row,col: ");
-            move.from = getLocation();
+            from = getLocation();
+            start = locationToSquare(from);
         }
         printf("\nTo row,col: ");
-        move.to = getLocation();
-        move.score = 0;
+        to = getLocation();
+        int fromSquare = locationToSquare(from);
+        int toSquare = locationToSquare(to);
+        uint32_t hop = (fromSquare >= 0 && toSquare >= 0) ? jumpedSquare(fromSquare, toSquare) : 0;
         invalid = true;
-        for (TMove *obj : *moveList) {
-            if (*obj == move) {
-                invalid = false;
-                doMove(board, move);
-                clearMoves(moveList);
-                if (jumped) {
-                    // Look for double jump
-                    jumped = false;
-                    for (int r_plus = -1; r_plus <= 1; r_plus += 2)
-                        for (int c_plus = -1; c_plus <= 1; c_plus += 2)
-                            checkJump(board, moveList, jumpPos.row - 1, jumpPos.col - 1,
-                                      r_plus, c_plus, &anotherJump);
+        for (TMove obj : moveList) {
+            if (obj.from() != start)
+                continue;
+            if (!obj.isJump()) {
+                if (obj.to() == toSquare) {
+                    invalid = false;
+                    game.play(obj);
+                    done = true;
+                    moveOk = true;
+                    break;
                 }
-                // Found move in the valid move list
-                if (moveList->size() < 1)  // No more jumps found
-                {
+            } else if (hop && !(hop & taken) && (obj.captured & hop)) {
+                // The hops so far are the start of this jump
+                invalid = false;
+                if (obj.to() == toSquare && obj.captured == (taken | hop)) {
+                    game.play(obj);
                     done = true;
                     moveOk = true;
-                } else {
-                    // From location is where we jumped to.
-                    move.from = move.to;
+                    break;
                 }
             }
         } // next obj
-        showBoard(board);
+        if (!invalid && !done) {
+            // Show the hop, the jump goes on from where it landed
+            doMove(shown, packMove(fromSquare, toSquare, hop));
+            taken |= hop;
+            anotherJump = true;
+            from = to;
+        }
+        showBoard(done ? game.board() : shown);
         if (!done) {
             if(invalid)
                 printf("\nInvalid move.\n");
@@ -268,57 +325,9 @@ bool humanMove(char *board)
         printf("\nInvalid"
                " move.\n");
 
-    currentColor = compColor; // Computer's turn
-    clearMoves(moveList);
-    delete (moveList);
     return moveOk;
 } // humanMove
 
-/****************************************************************************
- * Move the selected checker on the board.
- * @param board
- * @param move
- */
-void doMove(char *board, TMove move)
-{
-    int fromIdx = ((move.from.row - 1) * Cols) + (move.from.col - 1);
-    int toIdx = ((move.to.row - 1) * Cols) + (move.to.col - 1);
-    int jumpIdx = -1;
-
-    if (abs(move.from.row - move.to.row) == 2) {
-        int jr = move.to.row + ((move.from.row - move.to.row) / 2);
-        int jc = move.to.col + ((move.from.col - move.to.col) / 2);
-        jumpIdx = ((jr - 1) * Cols) + (jc - 1);
-        jumped = true;
-        jumpPos = move.to;
-    }
-    char checker = board[fromIdx];
-    board[fromIdx] = ' '; // clear from location
-    board[toIdx] = checker; // clear from location
-    if ((jumpIdx >= 0) && (jumpIdx < BoardSize))
-        board[jumpIdx] = ' ';
-    checkKings(main_board);
-} // doMove
-
-/***************************************************************************************
- *
- * @param board
- */
-void checkKings(char *board)
-{
-    char color = 'r'; // reds on row 1 to king
-    for (int rowIdx = 0; rowIdx < Rows; rowIdx += 7) {
-        if (rowIdx > 0)
-            color = 'b'; // blacks on row 8 to king
-        for (int colIdx = 0; colIdx < Cols; colIdx++) {
-            int idx = (rowIdx * Cols) + colIdx;
-            if (board[idx] == color)
-                // 1101 1111
-                board[idx] &= 0xDF; // to upper
-        }
-    }
-}
-
 /****************************************************************************
  * Get the location from the user.
  * @return
@@ -360,355 +369,65 @@ TLocation getLocation()
     return loc;
 } // getLocation
 
-/****************************************************************************
- * Get the value score for each move in the moves list.
- * @param board
- * @param moves
- * @param color - Color of the checker being moved
- * @return index for best move.
- */
-int scoreMoves(char *board, std::vector<TMove *> *moves, char mv_color)
-{
-    const int MaxLevel = 4;
-    static int level = 0;
-    static int winCount = 0;
-    static int stallCnt = 0;
-    //static bool debug_print = false;
-    char *tempBoard;
-    const int MaxStallCnt = 30;
-    level++;
-    int moveidx = 0;
-    int maxidx;
-    int minidx;
-    int maxscore = 0;
-    int minscore = 99;
-    char tcolor = mv_color;
-
-    int idx = 0;
-    // For each move in list
-    for (TMove *pMove : *moves) {
-        // get a fresh copy of the board
-        tempBoard = strdup(board);
-        // Do the move
-        bool done = true;
-        TMove mv = *pMove;
-        std::vector<TMove *> *moveList = new std::vector<TMove *>();
-
-        //if((level==1) && (pMove->from.col == 5)&& (pMove->to.col == 6)){
-        //    debug_print = true; // print all move scores in this path
-        //    printf("\n");
-        //}
-        //else if(level==1)
-        //    debug_print = false;
-
-        do
-        {
-            done = true;
-            jumped = false;
-            doMove(tempBoard, mv);
-            clearMoves(moveList);
-            if (jumped) {
-                bool jumps = false;
-                // Look for double jump
-                jumped = false;
-                for (int r_plus = -1; r_plus <= 1; r_plus += 2)
-                    for (int c_plus = -1; c_plus <= 1; c_plus += 2)
-                        checkJump(tempBoard, moveList, jumpPos.row - 1, jumpPos.col - 1,
-                                  r_plus, c_plus, &jumps);
-                // Found move in the valid move list
-                if (moveList->size() > 0)  // No more jumps found
-                {
-                    mv = *(*moveList)[0];
-                    done = false;
-                }
-            }
-        } while(!done);
-        tcolor = (mv_color == compColor) ? userColor : compColor;
-
-
-        pMove->score = 0;
-        // If level < MaxLevel
-        if(level < MaxLevel)
-        {
-
-            // Get tlist = list of counter moves
-            std::vector<TMove *> *tempMoves = getValidMoves(tempBoard, tcolor);
-
-            if(tempMoves->size() > 0){
-                // idx = scoreMoves tlist color
-                int tidx = scoreMoves(tempBoard, tempMoves, tcolor);
-                pMove->score = (*tempMoves)[tidx]->score;
-                //pMove->score += getScore(tempBoard);
-            }
-            // Cleanup
-            clearMoves(tempMoves);
-            delete (tempMoves);
-        }
-        pMove->score += getScore(tempBoard);  // Perhapps subtract level?
-        if(pMove->score > maxscore){
-            maxscore = pMove->score;
-            maxidx = idx;
-        }
-        if(pMove->score < minscore){
-            minscore = pMove->score;
-            minidx = idx;
-        }
-        //if(debug_print)
-        //{
-        //    showBoard(tempBoard);
-        //    printf("L=%d, from=%d,%d, to=%d,%d, score=%d, color='%c'\n", level, pMove->from.row, pMove->from.col,
-        //        pMove->to.row, pMove->to.col, pMove->score, mv_color);
-        //}
-
-        free(tempBoard);
-        idx++;
-
-    }
-
-    if(mv_color == currentColor)
-        moveidx = maxidx;
-    else
-        moveidx = minidx;
-
-    level--;
-    return moveidx;
-} // scoreMoves()
-
-
-/****************************************************************************
- * Return a copy of a move list vector.
- * @param moves
- * @return
- */
-std::vector<TMove *> *copyMoveList(std::vector<TMove *> *moves)
-{
-    std::vector<TMove *> *moves2 = new(std::vector<TMove *>);
-
-    for (TMove *move : *moves) {
-        TMove *ptr = new TMove();
-        ptr->from = move->from;
-        ptr->to = move->to;
-        ptr->score = move->score;
-        // Save move options
-        moves2->insert(moves2->end(), ptr);
-    }
-    return moves2;
-}
-
-/****************************************************************************
- * Get a score for the board based on the radio of computer checkers to
- * human checkers.
- * @param board
- * @return Score for computer color, higher is better
- */
-int getScore(char *board)
-{
-    double score = 0;
-    double userCheckers = 0, compCheckers = 0;
-    int idx = 0;
-
-    char c;
-    for (int rowIdx = 0; rowIdx < Rows; rowIdx++) {
-        for (int colIdx = 0; colIdx < Cols; colIdx++) {
-            c = board[idx++];
-            if (c == userColor) {
-                userCheckers++;
-                if ((colIdx) == 0 || (colIdx == (Cols - 1)))
-                    userCheckers += 1;
-            } else if (c == (userColor & 0xDF))
-                userCheckers += 1.5; // kings count more
-            else if (c == compColor) {
-                compCheckers++;
-                if ((colIdx) == 0 || (colIdx == (Cols - 1)))
-                    compCheckers +=  1;
-            } else if (c == (compColor & 0xDF))
-                compCheckers += 1.5; // kings count more
-        } // next colIdx
-    } // next rowIdx
-    if (userCheckers < 1.0)
-        score = 15.0; // hi score
-    else
-        score = compCheckers / userCheckers;
-    return static_cast<int>(score * 100.0);
-} // showBoard
-
-/****************************************************************************
- * Get a list of valid moves for the specified checker color
- * @param color
- * @return
- */
-std::vector<TMove *> *getValidMoves(char *board, char color)
-{
-    bool jumps = false;
-
-    std::vector<TMove *> *moves = new std::vector<TMove *>();
-    int idx = 0;
-    for (int rowIdx = 0; rowIdx < Rows; rowIdx++) {
-        for (int colIdx = 0; colIdx < Cols; colIdx++) {
-            char checkerColor = board[idx];
-
-            // ignore color case
-            if ((color | 0x20) == (checkerColor | 0x20)) {
-                checkerMoves(board, moves, rowIdx, colIdx, jumps);
-            }
-            idx++;
-        } // next colIdx
-    } // next rowIdx
-    return moves;
-} // getValidMoves
-
-/****************************************************************************
- * Get all valid moves for the checker at the specified position
- * @param board
- * @param moves
- * @param rowIdx
- * @param colIdx
- * @param jumps
- */
-void checkerMoves(const char *board, std::vector<TMove *> *moves,
-                  int rowIdx, int colIdx, bool &jumps)
-{
-    int r_plus = -1;
-    int idx = (rowIdx * Cols) + colIdx;
-    char checkerColor = board[idx];
-
-    for (int c_plus = -1; c_plus <= 1; c_plus += 2) {
-        r_plus = -1;
-        // Red & kings moves up from the bottom.
-        if (checkerColor == 'r' || checkerColor == 'R'
-            || checkerColor == 'B') {
-            if ((rowIdx > 0) && (rowIdx < Rows)) {
-                jumps = doChecks(board, moves, rowIdx, colIdx, jumps, r_plus, c_plus);
-            }
-        }
-        // Black & kings moves down from the top.
-        if (checkerColor == 'b' || checkerColor == 'R'
-            || checkerColor == 'B') {
-            r_plus = 1;
-            if ((rowIdx >= 0) && (rowIdx < Rows - 1)) {
-                jumps = doChecks(board, moves, rowIdx, colIdx, jumps, r_plus, c_plus);
-            }
-        }
-    } // next c_plus
-}
-
-bool doChecks(const char *board, std::vector<TMove *> *moves, int rowIdx, int colIdx, bool &jumps, int r_plus,
-              int c_plus)
-{
-    if ((colIdx >= 0) && (colIdx < Cols)) {
-        if (!checkMove(board, moves, rowIdx, colIdx,
-                       r_plus, c_plus, jumps)) {
-            checkJump(board, moves,
-                      rowIdx, colIdx, r_plus, c_plus, &jumps);
-        }
-
-    }
-    return jumps;
-} // doChecks
-
-/****************************************************************************
- * Check specific move, if valid add it to the moves list.
- * @param board
- * @param moves
- * @param rowIdx
- * @param colIdx
- * @param r_plus
- * @param c_plus
- */
-bool checkMove(const char *board, std::vector<TMove *> *moves, int rowIdx, int colIdx,
-               int r_plus, int c_plus, bool jumps)
-{
-    bool moveOk = false;
-    if (((rowIdx + r_plus) >= 0) && ((rowIdx + r_plus) < Rows) &&
-        ((colIdx + c_plus) >= 0) && ((colIdx + c_plus) < Cols)) {
-        int moveIdx = ((rowIdx + r_plus) * Cols) + (colIdx + c_plus);
-        char moveSquare = board[moveIdx];
-        if (moveSquare == ' ') // empty move
-        {
-            // If a jumpwas found, other moves are not options
-            if (!jumps) {
-                TMove *ptr = new TMove();
-                ptr->from.row = rowIdx + 1;
-                ptr->from.col = colIdx + 1;
-                ptr->to.row = (rowIdx + r_plus) + 1;
-                ptr->to.col = (colIdx + c_plus) + 1;
-                // Save move options
-                moves->insert(moves->end(), ptr);
-            }
-            moveOk = true;
-        }
-    }
-    return moveOk;
-}
-
-bool checkJump(const char *board, std::vector<TMove *> *moves,
-               int rowIdx, int colIdx, int r_plus, int c_plus, bool *jumps)
-{
-    int moveIdx = ((rowIdx + r_plus) * Cols) + (colIdx + c_plus);
-    int idx = rowIdx * Cols + colIdx;
-    char moveSquare = board[moveIdx];
-    bool jumpOk = false;
-    int r_jump_to = rowIdx + r_plus * 2;
-    int c_jump_to = colIdx + c_plus * 2;
-
-    char color = board[idx];
-    // If move square is a jumpable checker
-    if (((color | 0x20) != (moveSquare | 0x20)) && (moveSquare != ' ')
-        && (r_jump_to >= 0) && (r_jump_to < Rows)
-        && (c_jump_to >= 0) && (c_jump_to < Cols)) {
-
-        if (((color == 'b') && (r_plus > 0)) ||
-            ((color == 'r') && (r_plus < 0)) || !(color & 0x20)) {
-            moveIdx = (r_jump_to * Cols) + c_jump_to;
-            moveSquare = board[moveIdx];
-            // If move square is a jumpable checker
-            if (moveSquare == ' ') // empty move
-            {
-                TMove *ptr = new TMove();
-                ptr->from.row = rowIdx + 1;
-                ptr->from.col = colIdx + 1;
-                ptr->to.row = r_jump_to + 1;
-                ptr->to.col = c_jump_to + 1;
-                if (!*jumps) {
-                    clearMoves(moves);
-                    *jumps = true;
-                }
-                // save jump options
-                moves->insert(moves->end(), ptr);
-                jumpOk = true;
-            }
-        }
-    }
-    return jumpOk;
-} // checkJump
-
-void clearMoves(std::vector<TMove *> *moves)
-{
-    for (TMove *obj : *moves)
-        delete obj;
-    moves->clear();
-}
-
 /****************************************************************************
  * Print the provided checker board
  * @param board
  */
-void showBoard(char *board)
+void showBoard(const TBoard &board)
 {
     const char *topScale = "      1   2   3   4   5   6   7   8 ";
     const char *line = "    ---------------------------------";
-    int idx = 0;
     printf("\n%s", topScale);
     for (int rowIdx = 0; rowIdx < Rows; rowIdx++) {
         printf("\n%s\n", line);
         printf(" %d  |", (rowIdx + 1));
         for (int colIdx = 0; colIdx < Cols; colIdx++) {
-            printf(" %c |", board[idx++]);
+            printf(" %c |", pieceAt(board, rowIdx, colIdx));
         }
     }
     printf("\n%s\n", line);
 } // showBoard
 
+/****************************************************************************
+ * Count the positions to each depth up to the given one, with the time
+ * taken and the speed. With divide, the last depth also shows the count
+ * below each root move.
+ * @param fen - Position to start from, nullptr for the starting position
+ * @param depth
+ * @param divide
+ */
+template <class V>
+void runPerft(const char *fen, int depth, bool divide)
+{
+    TBoardOf<V> board = newBoard<V>();
+    int side = V::FirstSide;
+
+    if (fen && !parseFen(fen, board, side)) {
+        fprintf(stderr, "Invalid FEN: %s\n", fen);
+        exit(1);
+    }
+    char text[FenTextSize];
+    boardToFen(board, side, text, sizeof(text));
+    printf("%s\n", text);
+
+    for (int d = 1; d <= depth; d++) {
+        TPerftDivideOf<V> moves;
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = (divide && d == depth) ? perftDivide(board, side, d, moves) : perft(board, side, d);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (divide && d == depth) {
+            for (int idx = 0; idx < moves.count; idx++) {
+                char move[MoveTextSize];
+                moveToText(moves.moves[idx], move);
+                printf("  %-6s %llu\n", move, static_cast<unsigned long long>(moves.nodes[idx]));
+            }
+        }
+        printf("perft %2d: %12llu nodes %9.3fs %12.0f nodes/s\n", d, static_cast<unsigned long long>(nodes),
+               elapsed.count(), elapsed.count() > 0 ? nodes / elapsed.count() : 0.0);
+    }
+} // runPerft
+
 
 #ifdef LINUX_APP
 
@@ -0,0 +1,68 @@
+/****************************************************************************
+* Perft: count the positions a given number of turns from a position.
+****************************************************************************/
+#include "perft.h"
+
+/****************************************************************************
+ * Count the positions a number of turns from a position. The board is
+ * changed during the count and restored before returning.
+ * @param board
+ * @param side - Side to move
+ * @param depth - Turns to play
+ * @return The number of positions.
+ */
+template <class V>
+uint64_t perft(TBoardOf<V> &board, int side, int depth)
+{
+    TMoveListOf<V> moves;
+    TUndoOf<V> undo;
+
+    if (depth == 0)
+        return 1;
+    getValidMoves(board, side, moves);
+    // At the last turn the moves are the leaves
+    if (depth == 1)
+        return static_cast<uint64_t>(moves.size());
+    uint64_t nodes = 0;
+    for (TMoveOf<V> move : moves) {
+        makeMove(board, move, undo);
+        nodes += perft(board, side ^ 1, depth - 1);
+        unmakeMove(board, move, undo);
+    }
+    return nodes;
+} // perft
+
+/****************************************************************************
+ * Perft with the count below each root move, for finding which move a
+ * broken move generator gets wrong.
+ * @param board
+ * @param side
+ * @param depth - At least 1
+ * @param divide - Set to the root moves and their counts
+ * @return The total count.
+ */
+template <class V>
+uint64_t perftDivide(TBoardOf<V> &board, int side, int depth, TPerftDivideOf<V> &divide)
+{
+    TMoveListOf<V> moves;
+    TUndoOf<V> undo;
+    uint64_t total = 0;
+
+    getValidMoves(board, side, moves);
+    divide.count = 0;
+    for (TMoveOf<V> move : moves) {
+        makeMove(board, move, undo);
+        uint64_t nodes = perft(board, side ^ 1, depth - 1);
+        unmakeMove(board, move, undo);
+        divide.moves[divide.count] = move;
+        divide.nodes[divide.count++] = nodes;
+        total += nodes;
+    }
+    return total;
+}
+
+template uint64_t perft(TBoard &board, int side, int depth);
+template uint64_t perft(TBoardOf<TInternational> &board, int side, int depth);
+template uint64_t perftDivide(TBoard &board, int side, int depth, TPerftDivide &divide);
+template uint64_t perftDivide(TBoardOf<TInternational> &board, int side, int depth,
+                              TPerftDivideOf<TInternational> &divide);
@@ -0,0 +1,32 @@
+/****************************************************************************
+* Perft: count the positions a given number of turns from a position.
+*
+* A multiple jump is a single move, however many hops it takes, so the
+* counts can be checked against the published checkers perft numbers. From the
+* starting position they are 7, 49, 302, 1469, 7361, 36768, 179740, 845931,
+* 3963680 and 18391564 for depths 1 to 10. For international draughts they
+* are 9, 81, 658, 4265, 27117, 167140, 1049442 and 6483961 for depths 1 to 8.
+* ctest checks the shallower counts of both, see CMakeLists.txt.
+****************************************************************************/
+#ifndef CHECKERS_PERFT_H
+#define CHECKERS_PERFT_H
+
+#include "board.h"
+
+// Leaf count below one root move
+template <class V>
+struct TPerftDivideOf {
+    TMoveOf<V> moves[V::MaxMoves];
+    uint64_t nodes[V::MaxMoves];
+    int count;
+};
+
+typedef TPerftDivideOf<TAmerican> TPerftDivide;
+
+template <class V>
+uint64_t perft(TBoardOf<V> &board, int side, int depth);
+
+template <class V>
+uint64_t perftDivide(TBoardOf<V> &board, int side, int depth, TPerftDivideOf<V> &divide);
+
+#endif // CHECKERS_PERFT_H
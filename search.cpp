@@ -0,0 +1,650 @@
+/****************************************************************************
+* Alpha-beta game tree search.
+*
+* The search is a negamax alpha-beta with principal variation search: the
+* first move at each node is searched with the full window, the remaining
+* moves with a null window that is only widened when a move beats the best
+* score so far. Moves are ordered with the transposition table move first,
+* then jumps, killer moves and the history table.
+*
+* searchPosition() deepens one ply at a time until the depth, time or node
+* limit is reached. An iteration cut short by the limits is thrown away and
+* the move from the last completed iteration is played.
+*
+* With more than one thread the search is a Lazy SMP search: every thread
+* runs its own iterative deepening on the same position and they share
+* results only through the lock-free transposition table. Odd numbered
+* helper threads search one ply deeper so the threads spread out over the
+* tree. The main thread alone watches the limits and stops the others.
+*
+* At the horizon a quiescence search plays on while the side to move has a
+* jump, so that positions in the middle of an exchange aren't scored. Jumps
+* are compulsory, so a side can only stand pat on the static score when it
+* has no jump to make.
+*
+* When a tablebase is given, positions with few enough pieces are scored
+* from it instead of being searched, as a win or loss at the exact distance
+* or as a draw.
+*
+* Unless CHECKERS_STATS is 0 each thread counts evaluations, quiescence
+* nodes, move generator calls, table hits and cutoffs in its own context, and the
+* counts are summed into the result. writeSearchStats() writes them as a
+* JSON line.
+*
+* A multiple jump is a single move, so each ply of the search is a whole
+* turn.
+*
+* The search is a template on the rules variant like the board, and is
+* instantiated for TAmerican and TInternational at the end of the file.
+* The tablebase only serves American checkers.
+****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "search.h"
+#include "eval.h"
+
+// Move ordering scores, history scores stay below these.
+static const int TTMoveOrder = 8000000;
+static const int JumpOrder = 4000000;
+static const int KingCaptureOrder = 1000;
+static const int PromoteOrder = 3000000;
+static const int KillerOrder[2] = {2000000, 1900000};
+static const int MaxHistory = 1000000;
+// Nodes searched between checks of the clock
+static const uint64_t TimeCheckNodes = 1024;
+// Scores this close to WinScore are wins at a known distance, from the
+// search or from the tablebase
+static const int MaxWinDistance = MaxPly + MaxTablebasePlies;
+
+#if CHECKERS_STATS
+#define COUNT(ctx, counter) ((ctx).stats.counter++)
+#else
+#define COUNT(ctx, counter) ((void)0)
+#endif
+
+typedef std::chrono::steady_clock TClock;
+
+// State shared by all threads of one search
+struct TSharedSearch {
+    std::atomic<bool> stop;
+    std::atomic<uint64_t> nodes;   // updated every TimeCheckNodes nodes
+};
+
+template <class V>
+struct TSearchContext {
+    TTranspositionTable *tt;
+    const TTablebase *tablebase;    // nullptr for none, always for variants other than TAmerican
+    TSharedSearch *shared;
+    int threadId;       // 0 for the main thread
+    TMoveOf<V> killers[MaxPly][2];
+    int history[2][V::Squares][V::Squares];
+    TMoveOf<V> pv[MaxPly][MaxPly];
+    int pvLength[MaxPly];
+    uint64_t nodes;
+    uint64_t tbHits;
+    TSearchStats stats;
+    TSearchLimits limits;
+    TClock::time_point start;
+    bool canStop;       // the current iteration may be abandoned
+    bool stopped;       // a limit was reached, unwind the search
+};
+
+template <class V>
+static int alphaBeta(TSearchContext<V> &ctx, TBoardOf<V> &board, int side, int depth,
+                     int alpha, int beta, int ply);
+
+/****************************************************************************
+ * Score each move for move ordering.
+ * @param ctx
+ * @param board
+ * @param side
+ * @param moves
+ * @param ply
+ * @param ttMove - Best move from the transposition table
+ * @param scores - Filled with the ordering score of each move
+ */
+template <class V>
+static void orderMoves(const TSearchContext<V> &ctx, const TBoardOf<V> &board, int side,
+                       const TMoveListOf<V> &moves, int ply, TMoveOf<V> ttMove, int *scores)
+{
+    for (int idx = 0; idx < moves.size(); idx++) {
+        TMoveOf<V> move = moves[idx];
+        int score;
+        if (move.packed == ttMove.packed) {
+            score = TTMoveOrder;
+        } else if (move.isJump()) {
+            // Taking more pieces first, kings above men
+            score = JumpOrder + KingCaptureOrder * bitCount(move.captured & board.kings) + bitCount(move.captured);
+        } else if ((squareMask<V>(move.to()) & kingRow<V>(side)) && !(squareMask<V>(move.from()) & board.kings)) {
+            score = PromoteOrder;
+        } else if (move == ctx.killers[ply][0]) {
+            score = KillerOrder[0];
+        } else if (move == ctx.killers[ply][1]) {
+            score = KillerOrder[1];
+        } else {
+            score = ctx.history[side][move.from()][move.to()];
+        }
+        scores[idx] = score;
+    }
+} // orderMoves
+
+/****************************************************************************
+ * Swap the best scoring of the remaining moves into position idx.
+ * @param moves
+ * @param scores
+ * @param idx
+ */
+template <class V>
+static void pickMove(TMoveListOf<V> &moves, int *scores, int idx)
+{
+    int best = idx;
+    for (int i = idx + 1; i < moves.size(); i++) {
+        if (scores[i] > scores[best])
+            best = i;
+    }
+    if (best != idx) {
+        TMoveOf<V> move = moves[idx];
+        moves[idx] = moves[best];
+        moves[best] = move;
+        int score = scores[idx];
+        scores[idx] = scores[best];
+        scores[best] = score;
+    }
+}
+
+/****************************************************************************
+ * Record a quiet move that caused a beta cutoff.
+ * @param ctx
+ * @param side
+ * @param move
+ * @param depth
+ * @param ply
+ */
+template <class V>
+static void updateKillers(TSearchContext<V> &ctx, int side, TMoveOf<V> move, int depth, int ply)
+{
+    if (!(move == ctx.killers[ply][0])) {
+        ctx.killers[ply][1] = ctx.killers[ply][0];
+        ctx.killers[ply][0] = move;
+    }
+    int &history = ctx.history[side][move.from()][move.to()];
+    history += depth * depth;
+    if (history > MaxHistory) {
+        // Age the whole table so relative order is kept
+        for (int s = Black; s <= Red; s++)
+            for (int from = 0; from < V::Squares; from++)
+                for (int to = 0; to < V::Squares; to++)
+                    ctx.history[s][from][to] /= 2;
+    }
+}
+
+template <class V>
+static void updatePv(TSearchContext<V> &ctx, int ply, TMoveOf<V> move)
+{
+    ctx.pv[ply][0] = move;
+    memcpy(&ctx.pv[ply][1], &ctx.pv[ply + 1][0], ctx.pvLength[ply + 1] * sizeof(TMoveOf<V>));
+    ctx.pvLength[ply] = ctx.pvLength[ply + 1] + 1;
+}
+
+template <class V>
+static int64_t elapsedMs(const TSearchContext<V> &ctx)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(TClock::now() - ctx.start).count();
+}
+
+/****************************************************************************
+ * Called for every node. Every TimeCheckNodes nodes the main thread checks
+ * the node and time budgets and all threads check for a stop.
+ * @param ctx
+ */
+template <class V>
+static void checkLimits(TSearchContext<V> &ctx)
+{
+    if ((ctx.nodes % TimeCheckNodes) != 0)
+        return;
+    uint64_t nodes = ctx.shared->nodes.fetch_add(TimeCheckNodes, std::memory_order_relaxed) + TimeCheckNodes;
+    if (!ctx.canStop)
+        return;
+    if (ctx.threadId == 0) {
+        if ((ctx.limits.nodes && nodes >= ctx.limits.nodes) ||
+            (ctx.limits.timeMs && elapsedMs(ctx) >= ctx.limits.timeMs) ||
+            (ctx.limits.stop && ctx.limits.stop->load(std::memory_order_relaxed)))
+            ctx.shared->stop.store(true, std::memory_order_relaxed);
+    }
+    if (ctx.shared->stop.load(std::memory_order_relaxed))
+        ctx.stopped = true;
+}
+
+/****************************************************************************
+ * Win scores are stored in the transposition table as the distance from
+ * the stored position rather than from the root.
+ */
+static int scoreToTT(int score, int ply)
+{
+    if (score > WinScore - MaxWinDistance)
+        return score + ply;
+    if (score < MaxWinDistance - WinScore)
+        return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply)
+{
+    if (score > WinScore - MaxWinDistance)
+        return score - ply;
+    if (score < MaxWinDistance - WinScore)
+        return score + ply;
+    return score;
+}
+
+/****************************************************************************
+ * Score a position from the tablebase.
+ * @param ctx
+ * @param board
+ * @param side - Side to move
+ * @param ply
+ * @param score - Set to the score for the side to move
+ * @return false if the position isn't in the tablebase.
+ */
+static bool probeTablebase(TSearchContext<TAmerican> &ctx, const TBoard &board, int side, int ply, int &score)
+{
+    uint8_t value;
+    if (!ctx.tablebase->probe(board, side, value))
+        return false;
+    ctx.tbHits++;
+    if (tablebaseWin(value))
+        score = WinScore - ply - tablebasePlies(value);
+    else if (tablebaseLoss(value))
+        score = ply + tablebasePlies(value) - WinScore;
+    else
+        score = 0;
+    return true;
+}
+
+// The tablebase only holds American positions
+template <class V>
+static bool probeTablebase(TSearchContext<V> &, const TBoardOf<V> &, int, int, int &)
+{
+    return false;
+}
+
+/****************************************************************************
+ * Quiescence search below the horizon. Every jump is searched until the side
+ * to move has none, then the position is scored as it stands, or as a loss
+ * when the side has no moves at all.
+ * @param ctx
+ * @param board
+ * @param side - Side to move
+ * @param alpha
+ * @param beta
+ * @param ply - Distance from the root
+ * @return Score for the side to move.
+ */
+template <class V>
+static int quiesce(TSearchContext<V> &ctx, TBoardOf<V> &board, int side, int alpha, int beta, int ply)
+{
+    TMoveListOf<V> moves;
+    int scores[V::MaxMoves];
+    TMoveOf<V> noMove = {};
+
+    ctx.nodes++;
+    COUNT(ctx, qnodes);
+    ctx.pvLength[ply] = 0;
+    checkLimits(ctx);
+    if (ctx.stopped)
+        return 0;
+    int tbScore;
+    if (ctx.tablebase && probeTablebase(ctx, board, side, ply, tbScore))
+        return tbScore;
+    if (ply < MaxPly - 1) {
+        COUNT(ctx, moveGens);
+        getCaptures(board, side, moves);
+        // A side that can't move at all has lost, it can't stand pat
+        if (moves.size() == 0 && !hasQuietMoves(board, side))
+            return ply - WinScore;
+    }
+    if (moves.size() == 0) {
+        // Quiet, stand pat
+        COUNT(ctx, evals);
+        return getScore(board, side);
+    }
+
+    orderMoves(ctx, board, side, moves, ply, noMove, scores);
+    int bestScore = -Infinity;
+    for (int idx = 0; idx < moves.size(); idx++) {
+        TUndoOf<V> undo;
+        pickMove(moves, scores, idx);
+        TMoveOf<V> move = moves[idx];
+        makeMove(board, move, undo);
+        int score = -quiesce(ctx, board, side ^ 1, -beta, -alpha, ply + 1);
+        unmakeMove(board, move, undo);
+        if (ctx.stopped)
+            return 0;
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                updatePv(ctx, ply, move);
+                if (score >= beta)
+                    break;
+            }
+        }
+    }
+    return bestScore;
+} // quiesce
+
+/****************************************************************************
+ * Make the move, search the resulting position and take the move back.
+ * @return Score of the move for the side making it.
+ */
+template <class V>
+static int searchChild(TSearchContext<V> &ctx, TBoardOf<V> &board, int side, TMoveOf<V> move, int depth,
+                       int alpha, int beta, int ply)
+{
+    TUndoOf<V> undo;
+
+    makeMove(board, move, undo);
+    int score = -alphaBeta(ctx, board, side ^ 1, depth - 1, -beta, -alpha, ply + 1);
+    unmakeMove(board, move, undo);
+    return score;
+}
+
+/****************************************************************************
+ * Negamax alpha-beta search.
+ * @param ctx
+ * @param board
+ * @param side - Side to move
+ * @param depth - Remaining depth in plies
+ * @param alpha
+ * @param beta
+ * @param ply - Distance from the root
+ * @return Score for the side to move.
+ */
+template <class V>
+static int alphaBeta(TSearchContext<V> &ctx, TBoardOf<V> &board, int side, int depth,
+                     int alpha, int beta, int ply)
+{
+    TMoveListOf<V> moves;
+    int scores[V::MaxMoves];
+    TMoveOf<V> ttMove = {};
+    TTEntry entry;
+    bool pvNode = (beta - alpha) > 1;
+    int alphaOrig = alpha;
+
+    if (depth <= 0)
+        return quiesce(ctx, board, side, alpha, beta, ply);
+    ctx.nodes++;
+    ctx.pvLength[ply] = 0;
+    checkLimits(ctx);
+    if (ctx.stopped)
+        return 0;
+    if (ply >= MaxPly - 1) {
+        COUNT(ctx, evals);
+        return getScore(board, side);
+    }
+    int tbScore;
+    if (ctx.tablebase && ply > 0 && probeTablebase(ctx, board, side, ply, tbScore))
+        return tbScore;
+
+    // A position with no moves is never stored, so a cutoff is always safe
+    // before the moves are generated
+    uint64_t key = positionKey(board, side);
+    COUNT(ctx, ttProbes);
+    if (ctx.tt->probe(key, entry)) {
+        COUNT(ctx, ttHits);
+        ttMove.packed = entry.move;
+        if (!pvNode && entry.depth >= depth) {
+            int score = scoreFromTT(entry.score, ply);
+            if ((entry.bound == BoundExact) ||
+                (entry.bound == BoundLower && score >= beta) ||
+                (entry.bound == BoundUpper && score <= alpha)) {
+                COUNT(ctx, ttCutoffs);
+                return score;
+            }
+        }
+    }
+
+    COUNT(ctx, moveGens);
+    getValidMoves(board, side, moves);
+    if (moves.size() == 0)
+        return ply - WinScore; // no moves, side has lost
+
+    orderMoves(ctx, board, side, moves, ply, ttMove, scores);
+    int bestScore = -Infinity;
+    TMoveOf<V> bestMove = {};
+    for (int idx = 0; idx < moves.size(); idx++) {
+        pickMove(moves, scores, idx);
+        TMoveOf<V> move = moves[idx];
+        int score;
+        if (idx == 0) {
+            score = searchChild(ctx, board, side, move, depth, alpha, beta, ply);
+        } else {
+            score = searchChild(ctx, board, side, move, depth, alpha, alpha + 1, ply);
+            if (score > alpha && score < beta)
+                score = searchChild(ctx, board, side, move, depth, alpha, beta, ply);
+        }
+        if (ctx.stopped)
+            return 0; // result is incomplete, don't store it
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+            if (score > alpha) {
+                alpha = score;
+                updatePv(ctx, ply, move);
+                if (score >= beta) {
+                    COUNT(ctx, cutoffs);
+                    if (idx == 0)
+                        COUNT(ctx, firstCutoffs);
+                    if (!move.isJump())
+                        updateKillers(ctx, side, move, depth, ply);
+                    break;
+                }
+            }
+        }
+    } // next move
+
+    int bound = BoundExact;
+    if (bestScore >= beta)
+        bound = BoundLower;
+    else if (bestScore <= alphaOrig)
+        bound = BoundUpper;
+    ctx.tt->store(key, depth, bound, scoreToTT(bestScore, ply), bestMove.packed);
+    return bestScore;
+} // alphaBeta
+
+/****************************************************************************
+ * Iterative deepening loop run by each search thread.
+ * @param ctx
+ * @param board - The thread's own copy, moves are made and unmade on it
+ * @param side
+ * @param rootMoves - Number of legal moves at the root
+ * @param result - Set from each completed iteration
+ */
+template <class V>
+static void iterate(TSearchContext<V> &ctx, TBoardOf<V> board, int side, int rootMoves,
+                    TSearchResultOf<V> &result)
+{
+    const TSearchLimits &limits = ctx.limits;
+    int maxDepth = (limits.depth < 1 || limits.depth > MaxDepth) ? MaxDepth : limits.depth;
+    bool mainThread = (ctx.threadId == 0);
+
+    for (int depth = 1 + (ctx.threadId & 1); depth <= maxDepth; depth++) {
+        // The main thread always finishes the first iteration so there is a move to play
+        ctx.canStop = !mainThread || (depth > 1);
+        int score = alphaBeta(ctx, board, side, depth, -Infinity, Infinity, 0);
+        if (ctx.stopped)
+            break;
+        result.score = score;
+        result.depth = depth;
+        result.pvLength = ctx.pvLength[0];
+        memcpy(result.pv, ctx.pv[0], result.pvLength * sizeof(TMoveOf<V>));
+        result.move = result.pv[0];
+#if CHECKERS_STATS
+        ctx.stats.depthMs[depth] = elapsedMs(ctx);
+        ctx.stats.depthNodes[depth] = ctx.nodes;
+#endif
+        if (!mainThread)
+            continue;
+
+        if (rootMoves <= 1)
+            break; // nothing to choose
+        if (abs(score) > WinScore - MaxPly)
+            break; // found a forced win or loss
+        // The next iteration takes several times as long as this one
+        if (limits.timeMs && elapsedMs(ctx) * 2 > limits.timeMs)
+            break;
+    }
+} // iterate
+
+/****************************************************************************
+ * Find the best move for the side to move by iterative deepening.
+ * @param tt - Transposition table, may hold results of earlier searches
+ * @param board
+ * @param side - Side to move
+ * @param limits - Depth, time and node limits, see TSearchLimits
+ * @param threads - Number of search threads
+ * @param tablebase - Endgame tablebase, or nullptr for none
+ * @return The best move, its score and the principal variation from the
+ *         deepest completed iteration of any thread. pvLength is 0 when the
+ *         side has no moves.
+ */
+template <class V>
+TSearchResultOf<V> searchPosition(TTranspositionTable &tt, const TBoardOf<V> &board, int side,
+                             const TSearchLimits &limits, int threads,
+                             const TTablebase *tablebase)
+{
+    TSharedSearch shared;
+    TMoveListOf<V> rootMoves;
+
+    if (threads < 1)
+        threads = 1;
+    shared.stop = false;
+    shared.nodes = 0;
+    tt.newSearch();
+    getValidMoves(board, side, rootMoves);
+
+    // Value initialized, so the counters, tables and results start at zero
+    std::vector<TSearchContext<V>> contexts(threads);
+    std::vector<TSearchResultOf<V>> results(threads);
+    TClock::time_point start = TClock::now();
+    for (int id = 0; id < threads; id++) {
+        TSearchContext<V> &ctx = contexts[id];
+        ctx.tt = &tt;
+        ctx.tablebase = (tablebase && tablebase->maxPieces() > 0 && std::is_same<V, TAmerican>::value) ? tablebase
+                                                                                                       : nullptr;
+        ctx.shared = &shared;
+        ctx.threadId = id;
+        ctx.limits = limits;
+        ctx.start = start;
+    }
+
+    std::vector<std::thread> helpers;
+    for (int id = 1; id < threads; id++) {
+        helpers.emplace_back(iterate<V>, std::ref(contexts[id]), std::cref(board), side,
+                             rootMoves.size(), std::ref(results[id]));
+    }
+    iterate(contexts[0], board, side, rootMoves.size(), results[0]);
+    shared.stop = true;
+    for (std::thread &helper : helpers)
+        helper.join();
+
+    // Take the deepest completed iteration, the main thread's on a tie
+    TSearchResultOf<V> result = results[0];
+    uint64_t nodes = 0;
+    uint64_t tbHits = 0;
+    TSearchStats stats = contexts[0].stats;
+    for (int id = 0; id < threads; id++) {
+        if (results[id].depth > result.depth && results[id].pvLength > 0)
+            result = results[id];
+        nodes += contexts[id].nodes;
+        tbHits += contexts[id].tbHits;
+        if (id > 0) {
+            const TSearchStats &s = contexts[id].stats;
+            stats.evals += s.evals;
+            stats.qnodes += s.qnodes;
+            stats.moveGens += s.moveGens;
+            stats.ttProbes += s.ttProbes;
+            stats.ttHits += s.ttHits;
+            stats.ttCutoffs += s.ttCutoffs;
+            stats.cutoffs += s.cutoffs;
+            stats.firstCutoffs += s.firstCutoffs;
+        }
+    }
+    result.nodes = nodes;
+    result.tbHits = tbHits;
+    result.stats = stats;
+    result.timeMs = elapsedMs(contexts[0]);
+    return result;
+} // searchPosition
+
+/****************************************************************************
+ * Write the result and counters of a search as one JSON line. The effective
+ * branching factor is the main thread's node count for the last iteration
+ * over the one before.
+ * @param stream
+ * @param fields - JSON members to put first, such as a game number, without
+ *                 braces, or nullptr
+ * @param result
+ */
+template <class V>
+void writeSearchStats(FILE *stream, const char *fields, const TSearchResultOf<V> &result)
+{
+    const TSearchStats &s = result.stats;
+    char move[MoveTextSize] = "";
+    char buf[320];
+    std::string line = "{";
+
+    if (fields && *fields) {
+        line += fields;
+        line += ",";
+    }
+    if (result.pvLength > 0)
+        moveToText(result.move, move);
+    double ebf = 0;
+    int d = result.depth;
+    if (d >= 2 && s.depthNodes[d - 1] > (d >= 3 ? s.depthNodes[d - 2] : 0)) {
+        uint64_t last = s.depthNodes[d] - s.depthNodes[d - 1];
+        uint64_t previous = s.depthNodes[d - 1] - (d >= 3 ? s.depthNodes[d - 2] : 0);
+        ebf = static_cast<double>(last) / previous;
+    }
+    snprintf(buf, sizeof(buf), "\"move\":\"%s\",\"book\":%s,\"ponder_hit\":%s,\"score\":%d,\"depth\":%d,\"nodes\":%llu,"
+                               "\"time_ms\":%lld,\"nps\":%.0f,\"tb_hits\":%llu,\"counters\":%s,",
+             move, result.bookMove ? "true" : "false", result.ponderHit ? "true" : "false", result.score, result.depth,
+             static_cast<unsigned long long>(result.nodes), static_cast<long long>(result.timeMs),
+             result.timeMs > 0 ? result.nodes * 1000.0 / result.timeMs : 0.0,
+             static_cast<unsigned long long>(result.tbHits), CHECKERS_STATS ? "true" : "false");
+    line += buf;
+    snprintf(buf, sizeof(buf), "\"evals\":%llu,\"qnodes\":%llu,\"move_gens\":%llu,\"tt_probes\":%llu,\"tt_hits\":%llu,"
+                               "\"tt_cutoffs\":%llu,\"cutoffs\":%llu,\"first_move_cutoffs\":%llu,\"ebf\":%.2f,",
+             static_cast<unsigned long long>(s.evals), static_cast<unsigned long long>(s.qnodes),
+             static_cast<unsigned long long>(s.moveGens),
+             static_cast<unsigned long long>(s.ttProbes), static_cast<unsigned long long>(s.ttHits),
+             static_cast<unsigned long long>(s.ttCutoffs), static_cast<unsigned long long>(s.cutoffs),
+             static_cast<unsigned long long>(s.firstCutoffs), ebf);
+    line += buf;
+    line += "\"iterations\":[";
+    for (int depth = 1; depth <= result.depth; depth++) {
+        if (!s.depthNodes[depth])
+            continue; // not searched by the main thread
+        snprintf(buf, sizeof(buf), "%s{\"depth\":%d,\"ms\":%lld,\"nodes\":%llu}", line.back() == '[' ? "" : ",",
+                 depth, static_cast<long long>(s.depthMs[depth]), static_cast<unsigned long long>(s.depthNodes[depth]));
+        line += buf;
+    }
+    line += "]}\n";
+    // One write so lines from several threads don't interleave
+    fwrite(line.data(), 1, line.size(), stream);
+    fflush(stream);
+} // writeSearchStats
+
+template TSearchResult searchPosition(TTranspositionTable &tt, const TBoard &board, int side,
+                                      const TSearchLimits &limits, int threads, const TTablebase *tablebase);
+template TSearchResultOf<TInternational> searchPosition(TTranspositionTable &tt, const TBoardOf<TInternational> &board,
+                                                        int side, const TSearchLimits &limits, int threads,
+                                                        const TTablebase *tablebase);
+template void writeSearchStats(FILE *stream, const char *fields, const TSearchResult &result);
+template void writeSearchStats(FILE *stream, const char *fields, const TSearchResultOf<TInternational> &result);
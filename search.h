@@ -0,0 +1,79 @@
+/****************************************************************************
+* Alpha-beta game tree search.
+****************************************************************************/
+#ifndef CHECKERS_SEARCH_H
+#define CHECKERS_SEARCH_H
+
+#include <stdio.h>
+#include <atomic>
+#include "board.h"
+#include "tablebase.h"
+#include "tt.h"
+
+// Build with CHECKERS_STATS=0 to compile the search counters out
+#ifndef CHECKERS_STATS
+#define CHECKERS_STATS 1
+#endif
+
+const int MaxPly = 64;
+// Deepest iteration, leaving room below MaxPly
+const int MaxDepth = 48;
+const int Infinity = 32000;
+// Score for a side that has won, less the number of plies to the win.
+const int WinScore = 30000;
+
+/****************************************************************************
+ * Limits for one search. A zero time or node budget means no limit.
+ */
+struct TSearchLimits {
+    int depth;          // deepest iteration in plies, 0 for MaxDepth
+    int64_t timeMs;     // time budget in milliseconds
+    uint64_t nodes;     // node budget
+    // Set by another thread to end the search early, nullptr for none
+    const std::atomic<bool> *stop;
+};
+
+/****************************************************************************
+ * Search counters, summed over the search threads. The per iteration times
+ * and node counts are the main thread's. All zero when the counters are
+ * compiled out.
+ */
+struct TSearchStats {
+    uint64_t evals;                     // leaves scored by getScore()
+    uint64_t qnodes;                    // quiescence nodes, included in the node count
+    uint64_t moveGens;                  // move generator calls
+    uint64_t ttProbes;
+    uint64_t ttHits;
+    uint64_t ttCutoffs;                 // nodes answered by a table entry
+    uint64_t cutoffs;                   // beta cutoffs
+    uint64_t firstCutoffs;              // beta cutoffs by the first move searched
+    int64_t depthMs[MaxDepth + 1];      // time when each iteration finished
+    uint64_t depthNodes[MaxDepth + 1];  // nodes when each iteration finished
+};
+
+template <class V>
+struct TSearchResultOf {
+    TMoveOf<V> move;            // best move, only valid when pvLength > 0
+    int score;             // score for the side to move
+    int depth;             // deepest completed iteration
+    uint64_t nodes;
+    uint64_t tbHits;       // positions answered by the tablebase
+    bool bookMove;         // move came from the opening book, not a search
+    bool ponderHit;        // search began on the opponent's time, see Engine::ponder()
+    int64_t timeMs;
+    TMoveOf<V> pv[MaxPly]; // principal variation, starting with move
+    int pvLength;
+    TSearchStats stats;
+};
+
+typedef TSearchResultOf<TAmerican> TSearchResult;
+
+template <class V>
+TSearchResultOf<V> searchPosition(TTranspositionTable &tt, const TBoardOf<V> &board, int side,
+                                  const TSearchLimits &limits, int threads,
+                                  const TTablebase *tablebase = nullptr);
+
+template <class V>
+void writeSearchStats(FILE *stream, const char *fields, const TSearchResultOf<V> &result);
+
+#endif // CHECKERS_SEARCH_H
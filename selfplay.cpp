@@ -0,0 +1,340 @@
+/****************************************************************************
+* Headless self-play match runner.
+*
+* Plays the engine against itself for a number of games, several games at a
+* time on a pool of worker threads. Each side can have its own search
+* limits. Each finished game is written to stdout as one JSON line, and a
+* final JSON line holds the totals.
+*
+* Options:
+*   --games <count>         Games to play (default 100)
+*   --concurrency <count>   Games played at once (default: hardware threads)
+*   --depth <plies>         Search depth for both sides
+*   --movetime <ms>         Time per move for both sides
+*   --nodes <count>         Nodes per move for both sides
+*   --black-depth, --black-movetime, --black-nodes
+*   --red-depth, --red-movetime, --red-nodes
+*                           Limits for one side only
+*   --random-plies <count>  Random opening plies before the engines play
+*   --seed <n>              Seed for the random openings (default 1)
+*   --hash <MB>             Transposition table size for each side
+*   --threads <count>       Search threads for each search (default 1)
+*   --tablebase <path>      Endgame tablebase for both sides
+*   --book <path>           Opening book for both sides
+*   --weights <path>        Evaluation weights for both sides
+*   --stats <path>          Write a JSON line of search statistics for every
+*                           move to the file
+*   --positions <path>      Write the positions the engines moved from, each
+*                           with the game's result, for checkers_tune
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "engine.h"
+#include "eval.h"
+
+// Longest game before it is called a draw
+const int MaxGamePlies = 400;
+
+struct TMatchOptions {
+    int games;
+    int concurrency;
+    TSearchLimits limits[2];    // indexed by side
+    int randomPlies;
+    unsigned seed;
+    TEngineConfig engine;
+    const char *tablebase;      // nullptr for none
+    const char *book;           // nullptr for none
+    FILE *stats;                // nullptr for none
+    FILE *positions;            // nullptr for none
+};
+
+struct TMatchStats {
+    std::atomic<int> blackWins;
+    std::atomic<int> redWins;
+    std::atomic<int> draws;
+    std::atomic<uint64_t> plies;
+};
+
+static std::mutex outputMutex;
+
+/****************************************************************************
+ * Play random moves from the starting position. Stops early if the game
+ * ends.
+ * @param game
+ * @param plies - Turns to play
+ * @param rng
+ */
+static void randomOpening(Game &game, int plies, std::mt19937 &rng)
+{
+    TMoveList moves;
+    for (int ply = 0; ply < plies && game.result() == GameOngoing; ply++) {
+        game.legalMoves(moves);
+        game.play(moves[rng() % moves.size()]);
+    }
+}
+
+/****************************************************************************
+ * Write the moves of a game as a JSON array of PDN moves, e.g. "9x18x27"
+ * for a multiple jump.
+ * @param history
+ * @return
+ */
+static std::string movesToJson(const std::vector<TMove> &history)
+{
+    std::string json = "[";
+    char text[MoveTextSize];
+
+    for (size_t idx = 0; idx < history.size(); idx++) {
+        moveToText(history[idx], text);
+        json += (idx > 0) ? ",\"" : "\"";
+        json += text;
+        json += "\"";
+    }
+    return json + "]";
+}
+
+/****************************************************************************
+ * Write positions of a game, one per line as a FEN and the game's result.
+ * @param history
+ * @param from - Ply of the first position to write
+ * @param result - PDN result, such as 1-0
+ * @return
+ */
+static std::string labelledPositions(const std::vector<TMove> &history, size_t from, const char *result)
+{
+    std::string text;
+    char fen[FenTextSize];
+    TBoard board = newBoard();
+    int side = Black;
+
+    for (size_t ply = 0; ply < history.size(); ply++) {
+        if (ply >= from) {
+            boardToFen(board, side, fen, sizeof(fen));
+            text += fen;
+            text += ' ';
+            text += result;
+            text += '\n';
+        }
+        doMove(board, history[ply]);
+        side ^= 1;
+    }
+    return text;
+}
+
+/****************************************************************************
+ * Play one game between the two engines.
+ * @param index - Game number, selects the random opening
+ * @param options
+ * @param engines - Engine for each side
+ * @param stats
+ */
+static void playGame(int index, const TMatchOptions &options, Engine *const engines[2], TMatchStats &stats)
+{
+    Game game;
+    std::mt19937 rng(options.seed + index);
+
+    engines[Black]->newGame();
+    engines[Red]->newGame();
+    randomOpening(game, options.randomPlies, rng);
+    size_t openingPlies = game.history().size();
+
+    TGameResult result = game.result();
+    while (result == GameOngoing && game.history().size() < MaxGamePlies) {
+        int side = game.sideToMove();
+        TSearchResult search = engines[side]->think(game, options.limits[side]);
+        if (options.stats) {
+            char fields[64];
+            snprintf(fields, sizeof(fields), "\"game\":%d,\"ply\":%d,\"side\":\"%s\"", index + 1,
+                     static_cast<int>(game.history().size()), (side == Black) ? "black" : "red");
+            writeSearchStats(options.stats, fields, search);
+        }
+        game.play(search.move);
+        result = game.result();
+    }
+
+    const char *winner = "draw";
+    const char *pdnResult = "1/2-1/2";
+    if (result == BlackWins) {
+        winner = "black";
+        pdnResult = "1-0";
+        stats.blackWins++;
+    } else if (result == RedWins) {
+        winner = "red";
+        pdnResult = "0-1";
+        stats.redWins++;
+    } else {
+        stats.draws++;
+    }
+    stats.plies += game.history().size();
+
+    std::string moves = movesToJson(game.history());
+    std::string positions;
+    if (options.positions)
+        positions = labelledPositions(game.history(), openingPlies, pdnResult);
+    std::lock_guard<std::mutex> lock(outputMutex);
+    if (options.positions)
+        fputs(positions.c_str(), options.positions);
+    printf("{\"game\":%d,\"result\":\"%s\",\"plies\":%d,\"opening_plies\":%d,\"moves\":%s}\n",
+           index + 1, winner, static_cast<int>(game.history().size()), static_cast<int>(openingPlies),
+           moves.c_str());
+    fflush(stdout);
+} // playGame
+
+/****************************************************************************
+ * Worker thread, plays games until all have been started.
+ */
+static void worker(const TMatchOptions &options, std::atomic<int> &nextGame, TMatchStats &stats)
+{
+    Engine black(options.engine);
+    Engine red(options.engine);
+    if (options.tablebase) {
+        black.loadTablebase(options.tablebase);
+        red.loadTablebase(options.tablebase);
+    }
+    if (options.book) {
+        black.loadBook(options.book);
+        red.loadBook(options.book);
+    }
+    Engine *const engines[2] = {&black, &red};
+
+    for (int index = nextGame++; index < options.games; index = nextGame++)
+        playGame(index, options, engines, stats);
+}
+
+static bool parseLimit(const char *name, const char *value, TSearchLimits &limits)
+{
+    if (strcmp(name, "depth") == 0)
+        limits.depth = atoi(value);
+    else if (strcmp(name, "movetime") == 0)
+        limits.timeMs = strtoll(value, nullptr, 10);
+    else if (strcmp(name, "nodes") == 0)
+        limits.nodes = strtoull(value, nullptr, 10);
+    else
+        return false;
+    return true;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--games count] [--concurrency count] [--depth plies] [--movetime ms]"
+                    " [--nodes count]\n"
+                    "       [--black-depth|--black-movetime|--black-nodes n]"
+                    " [--red-depth|--red-movetime|--red-nodes n]\n"
+                    "       [--random-plies count] [--seed n] [--hash MB] [--threads count]\n"
+                    "       [--tablebase path] [--book path] [--weights path] [--stats path] [--positions path]\n", program);
+}
+
+int main(int argc, char *argv[])
+{
+    TMatchOptions options;
+    TMatchStats stats;
+    const char *weights = nullptr;
+
+    options.games = 100;
+    options.concurrency = static_cast<int>(std::thread::hardware_concurrency());
+    options.limits[Black] = options.limits[Red] = {8, 0, 0, nullptr};
+    options.randomPlies = 0;
+    options.seed = 1;
+    options.engine = DefaultEngineConfig;
+    options.tablebase = nullptr;
+    options.book = nullptr;
+    options.stats = nullptr;
+    options.positions = nullptr;
+    stats.blackWins = stats.redWins = stats.draws = 0;
+    stats.plies = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        arg += 2;
+        if (strcmp(arg, "games") == 0) {
+            options.games = atoi(value);
+        } else if (strcmp(arg, "concurrency") == 0) {
+            options.concurrency = atoi(value);
+        } else if (strcmp(arg, "random-plies") == 0) {
+            options.randomPlies = atoi(value);
+        } else if (strcmp(arg, "seed") == 0) {
+            options.seed = static_cast<unsigned>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "hash") == 0) {
+            options.engine.hashMegabytes = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "threads") == 0) {
+            options.engine.threads = atoi(value);
+        } else if (strcmp(arg, "tablebase") == 0) {
+            options.tablebase = value;
+        } else if (strcmp(arg, "book") == 0) {
+            options.book = value;
+        } else if (strcmp(arg, "weights") == 0) {
+            weights = value;
+        } else if (strcmp(arg, "stats") == 0) {
+            options.stats = fopen(value, "a");
+            if (!options.stats) {
+                perror(value);
+                return 1;
+            }
+        } else if (strcmp(arg, "positions") == 0) {
+            options.positions = fopen(value, "a");
+            if (!options.positions) {
+                perror(value);
+                return 1;
+            }
+        } else if (strncmp(arg, "black-", 6) == 0) {
+            if (!parseLimit(arg + 6, value, options.limits[Black])) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strncmp(arg, "red-", 4) == 0) {
+            if (!parseLimit(arg + 4, value, options.limits[Red])) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!parseLimit(arg, value, options.limits[Black]) ||
+                   !parseLimit(arg, value, options.limits[Red])) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.concurrency < 1)
+        options.concurrency = 1;
+    if (weights && !loadEvalWeights(weights)) {
+        fprintf(stderr, "Can't read evaluation weights %s\n", weights);
+        return 1;
+    }
+    TTablebase check;
+    if (options.tablebase && !check.open(options.tablebase)) {
+        fprintf(stderr, "Can't read tablebase %s\n", options.tablebase);
+        return 1;
+    }
+    check.close();
+    TOpeningBook checkBook;
+    if (options.book && !checkBook.open(options.book)) {
+        fprintf(stderr, "Can't read opening book %s\n", options.book);
+        return 1;
+    }
+    checkBook.close();
+
+    std::atomic<int> nextGame(0);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < options.concurrency; i++)
+        workers.emplace_back(worker, std::cref(options), std::ref(nextGame), std::ref(stats));
+    for (std::thread &t : workers)
+        t.join();
+
+    int games = stats.blackWins + stats.redWins + stats.draws;
+    printf("{\"summary\":true,\"games\":%d,\"black_wins\":%d,\"red_wins\":%d,\"draws\":%d,"
+           "\"black_score\":%.3f,\"average_plies\":%.1f}\n",
+           games, stats.blackWins.load(), stats.redWins.load(), stats.draws.load(),
+           games ? (stats.blackWins + 0.5 * stats.draws) / games : 0.0,
+           games ? static_cast<double>(stats.plies) / games : 0.0);
+    return 0;
+} // main
@@ -0,0 +1,714 @@
+/****************************************************************************
+* Engine server.
+*
+* Hosts any number of games for other programs, over stdin/stdout and over
+* a Unix domain socket. Each connection sends commands one per line and
+* names its games with its own ids. A single thread runs a poll() loop over
+* every connection and hands searches to a pool of worker threads, each
+* with its own Engine, and an engine for international draughts made when
+* it first searches a draughts game. A finished search is sent back to the loop through
+* a pipe and written to the connection that asked for it.
+*
+* Commands, replies are one line each:
+*   new <game> [<variant>]      start a game from the opening position,
+*                               variant american (the default) or
+*                               international -> ok <game>
+*   position <game> <fen>       set up a position, see parseFen()
+*                               -> ok <game>
+*   move <game> <move>          play a turn for the side to move, such as
+*                               11-15 or 15x22x29 -> ok <game>
+*   go <game> [depth <plies>] [movetime <ms>] [nodes <count>]
+*                               search for the side to move, no limits
+*                               searches until stop
+*                               -> bestmove <game> <move> score <score>
+*                                  depth <plies> nodes <count> time <ms>
+*                               or bestmove <game> none when the game is over
+*   stop <game>                 end the game's search, its bestmove follows
+*   show <game>                 -> position <game> <fen> <result>, result is
+*                                  ongoing, black, red or draw, red is
+*                                  white in international draughts
+*   free <game>                 forget the game -> ok <game>
+*   ping                        -> pong
+*   quit                        stop the connection's searches and close
+*                               it once their bestmoves are sent
+* A command that can't be carried out gets error <game> <reason>. A game
+* with a search running takes no other command but stop, show and ping.
+* The end of a connection's input stops its searches without limits, the
+* others run to their limits, and the connection closes once the bestmoves
+* are sent.
+*
+* Options:
+*   --socket <path>     Listen on a Unix domain socket as well
+*   --no-stdin          Don't read commands from stdin
+*   --workers <count>   Searches run at once (default: hardware threads)
+*   --hash <MB>         Transposition table size for each worker
+*   --shared-hash <name> One transposition table for every worker, in the
+*                       named shared memory segment, shared with any other
+*                       process using the name. International games use
+*                       their own segment, the name with "-international"
+*                       added
+*   --threads <count>   Search threads for each search (default 1)
+*   --tablebase <path>  Endgame tablebase, for american games
+*   --book <path>       Opening book, for american games
+*   --weights <path>    Evaluation weights
+****************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "engine.h"
+#include "eval.h"
+
+struct TServerOptions {
+    const char *socketPath;     // nullptr for none
+    bool useStdin;
+    int workers;
+    TEngineConfig engine;
+    const char *tablebase;      // nullptr for none
+    const char *book;           // nullptr for none
+    const char *sharedHash;     // shared memory table name, nullptr for none
+};
+
+// International draughts game
+typedef BasicGame<TInternational> TDraughtsGame;
+
+// A search waiting for or running on a worker
+struct TSearchJob {
+    int connection;
+    std::string gameId;
+    bool international;     // search draughts, not game
+    Game game;
+    TDraughtsGame draughts;
+    TSearchLimits limits;
+    std::shared_ptr<std::atomic<bool>> stop;
+};
+
+// A finished search for the event loop to send
+struct TSearchReply {
+    int connection;
+    std::string gameId;
+    std::string text;
+};
+
+struct TServerGame {
+    bool international;     // draughts holds the game, not game
+    Game game;
+    TDraughtsGame draughts;
+    std::shared_ptr<std::atomic<bool>> stop;    // set while a search runs
+    bool unlimited;                             // the search runs until stop
+};
+
+struct TConnection {
+    int inFd;
+    int outFd;
+    std::string input;
+    std::string output;                 // waiting to be written
+    std::map<std::string, TServerGame> games;
+    int searches;                       // searches not yet replied to
+    bool closing;                       // close once searches and output are done
+};
+
+/****************************************************************************
+ * Worker threads and the queues between them and the event loop.
+ */
+class TWorkerPool {
+public:
+    TWorkerPool(const TServerOptions &options);
+
+    ~TWorkerPool();
+
+    void submit(TSearchJob &&job);
+
+    void takeReplies(std::vector<TSearchReply> &replies);
+
+    // Readable when replies are waiting
+    int wakeFd() const
+    {
+        return wakePipe[0];
+    }
+
+private:
+    void run(Engine *engine);
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<TSearchJob> jobs;
+    std::vector<TSearchReply> replies;
+    bool shutdown;
+    int wakePipe[2];
+    std::vector<std::unique_ptr<Engine>> engines;
+    std::vector<std::thread> threads;
+    TEngineConfig engineConfig;
+    const char *sharedHash;
+};
+
+TWorkerPool::TWorkerPool(const TServerOptions &options)
+        : shutdown(false), engineConfig(options.engine), sharedHash(options.sharedHash)
+{
+    if (pipe(wakePipe) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+    for (int id = 0; id < options.workers; id++) {
+        engines.emplace_back(new Engine(options.engine));
+        if (options.tablebase)
+            engines.back()->loadTablebase(options.tablebase);
+        if (options.book)
+            engines.back()->loadBook(options.book);
+        if (options.sharedHash)
+            engines.back()->shareTable(options.sharedHash);
+        threads.emplace_back(&TWorkerPool::run, this, engines.back().get());
+    }
+}
+
+TWorkerPool::~TWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutdown = true;
+        for (TSearchJob &job : jobs)
+            job.stop->store(true);
+    }
+    ready.notify_all();
+    for (std::thread &t : threads)
+        t.join();
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+}
+
+void TWorkerPool::submit(TSearchJob &&job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    ready.notify_one();
+}
+
+void TWorkerPool::takeReplies(std::vector<TSearchReply> &taken)
+{
+    char buf[64];
+    while (read(wakePipe[0], buf, sizeof(buf)) > 0)
+        continue;
+    std::lock_guard<std::mutex> lock(mutex);
+    taken.swap(replies);
+    replies.clear();
+}
+
+/****************************************************************************
+ * Search a game and write the reply to send.
+ * @param engine
+ * @param job
+ * @param game - The job's game
+ * @return The bestmove line.
+ */
+template <class V>
+static std::string searchGame(BasicEngine<V> &engine, const TSearchJob &job, const BasicGame<V> &game)
+{
+    std::ostringstream text;
+    TSearchResultOf<V> result;
+    result.pvLength = 0;
+    if (game.result() == GameOngoing)
+        result = engine.think(game, job.limits);
+    if (result.pvLength == 0) {
+        text << "bestmove " << job.gameId << " none";
+    } else {
+        char move[MoveTextSize];
+        moveToText(result.move, move);
+        text << "bestmove " << job.gameId << " " << move << " score " << result.score << " depth "
+             << result.depth << " nodes " << result.nodes << " time " << result.timeMs;
+    }
+    return text.str();
+}
+
+/****************************************************************************
+ * Worker thread.
+ */
+void TWorkerPool::run(Engine *engine)
+{
+    std::unique_ptr<BasicEngine<TInternational>> draughtsEngine;
+
+    for (;;) {
+        TSearchJob job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return shutdown || !jobs.empty(); });
+            if (shutdown)
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        TSearchReply reply = {job.connection, job.gameId, ""};
+        if (job.international) {
+            if (!draughtsEngine) {
+                draughtsEngine.reset(new BasicEngine<TInternational>(engineConfig));
+                if (sharedHash)
+                    draughtsEngine->shareTable((std::string(sharedHash) + "-international").c_str());
+            }
+            reply.text = searchGame(*draughtsEngine, job, job.draughts);
+        } else {
+            reply.text = searchGame(*engine, job, job.game);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        replies.push_back(reply);
+        if (write(wakePipe[1], "", 1) < 0) {
+            // The pipe is full, so the loop is already awake
+        }
+    }
+} // run
+
+static std::map<int, TConnection> connections;
+static int nextConnection = 0;
+
+/****************************************************************************
+ * Stop the searches running for the connection's games. Each still sends
+ * its bestmove.
+ * @param conn
+ * @param unlimitedOnly - Only stop the searches that have no limits
+ */
+static void stopSearches(TConnection &conn, bool unlimitedOnly = false)
+{
+    for (auto &entry : conn.games) {
+        if (entry.second.stop && (!unlimitedOnly || entry.second.unlimited))
+            entry.second.stop->store(true);
+    }
+}
+
+static void send(TConnection &conn, const std::string &line)
+{
+    conn.output += line;
+    conn.output += '\n';
+}
+
+static bool parseLimits(std::istringstream &args, TSearchLimits &limits)
+{
+    std::string name;
+    limits = {0, 0, 0, nullptr};
+    while (args >> name) {
+        long long value;
+        if (!(args >> value) || value < 0)
+            return false;
+        if (name == "depth")
+            limits.depth = static_cast<int>(value);
+        else if (name == "movetime")
+            limits.timeMs = value;
+        else if (name == "nodes")
+            limits.nodes = static_cast<uint64_t>(value);
+        else
+            return false;
+    }
+    return true;
+}
+
+static const char *resultName(TGameResult result)
+{
+    static const char *const names[] = {"ongoing", "black", "red", "draw"};
+    return names[result];
+}
+
+/****************************************************************************
+ * Reply to show for a game.
+ */
+template <class V>
+static void showGame(TConnection &conn, const std::string &gameId, const BasicGame<V> &game)
+{
+    char fen[FenTextSize];
+    boardToFen(game.board(), game.sideToMove(), fen, sizeof(fen));
+    send(conn, "position " + gameId + " " + fen + " " + resultName(game.result()));
+}
+
+/****************************************************************************
+ * Set up a game from a FEN position.
+ * @return false if the position isn't valid, the game is unchanged.
+ */
+template <class V>
+static bool setPosition(BasicGame<V> &game, const std::string &fen)
+{
+    TBoardOf<V> board;
+    int side;
+    if (!parseFen(fen.c_str(), board, side))
+        return false;
+    game = BasicGame<V>(board, side);
+    return true;
+}
+
+/****************************************************************************
+ * Carry out one command line from a connection.
+ * @param id - Connection id
+ * @param conn
+ * @param line
+ * @param pool
+ */
+static void handleCommand(int id, TConnection &conn, const std::string &line, TWorkerPool &pool)
+{
+    std::istringstream args(line);
+    std::string command, gameId;
+    if (!(args >> command))
+        return; // blank line
+    if (command == "ping") {
+        send(conn, "pong");
+        return;
+    }
+    if (command == "quit") {
+        // No stop can follow, so searches without limits would never end
+        conn.closing = true;
+        stopSearches(conn);
+        return;
+    }
+    if (!(args >> gameId)) {
+        send(conn, "error " + command + " needs a game id");
+        return;
+    }
+
+    auto it = conn.games.find(gameId);
+    if (command == "new") {
+        std::string variant = "american";
+        args >> variant;
+        if (variant != "american" && variant != "international") {
+            send(conn, "error " + gameId + " unknown variant " + variant);
+            return;
+        }
+        if (it != conn.games.end() && it->second.stop) {
+            send(conn, "error " + gameId + " busy");
+            return;
+        }
+        conn.games[gameId] = TServerGame();
+        conn.games[gameId].international = (variant == "international");
+        send(conn, "ok " + gameId);
+        return;
+    }
+    if (it == conn.games.end()) {
+        send(conn, "error " + gameId + " no such game");
+        return;
+    }
+    TServerGame &game = it->second;
+    if (command == "show") {
+        if (game.international)
+            showGame(conn, gameId, game.draughts);
+        else
+            showGame(conn, gameId, game.game);
+        return;
+    }
+    if (command == "stop") {
+        if (game.stop)
+            game.stop->store(true);
+        else
+            send(conn, "error " + gameId + " not searching");
+        return;
+    }
+    if (game.stop) {
+        send(conn, "error " + gameId + " busy");
+        return;
+    }
+
+    if (command == "free") {
+        conn.games.erase(it);
+        send(conn, "ok " + gameId);
+    } else if (command == "position") {
+        std::string fen;
+        std::getline(args >> std::ws, fen);
+        if (!(game.international ? setPosition(game.draughts, fen) : setPosition(game.game, fen))) {
+            send(conn, "error " + gameId + " bad position");
+            return;
+        }
+        send(conn, "ok " + gameId);
+    } else if (command == "move") {
+        std::string move;
+        if (!(args >> move) ||
+            !(game.international ? game.draughts.playText(move.c_str()) : game.game.playText(move.c_str())))
+            send(conn, "error " + gameId + " illegal move");
+        else
+            send(conn, "ok " + gameId);
+    } else if (command == "go") {
+        TSearchJob job;
+        if (!parseLimits(args, job.limits)) {
+            send(conn, "error " + gameId + " bad limits");
+            return;
+        }
+        game.stop = std::make_shared<std::atomic<bool>>(false);
+        game.unlimited = !job.limits.depth && !job.limits.timeMs && !job.limits.nodes;
+        job.connection = id;
+        job.gameId = gameId;
+        job.international = game.international;
+        if (game.international)
+            job.draughts = game.draughts;
+        else
+            job.game = game.game;
+        job.stop = game.stop;
+        job.limits.stop = job.stop.get();
+        conn.searches++;
+        pool.submit(std::move(job));
+    } else {
+        send(conn, "error " + gameId + " unknown command " + command);
+    }
+} // handleCommand
+
+/****************************************************************************
+ * Read what a connection has sent and carry out each complete line.
+ * @return false at end of file or on an error.
+ */
+static bool readConnection(int id, TConnection &conn, TWorkerPool &pool)
+{
+    char buf[4096];
+    ssize_t n = read(conn.inFd, buf, sizeof(buf));
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return true;
+    if (n <= 0)
+        return false;
+    conn.input.append(buf, static_cast<size_t>(n));
+    size_t eol;
+    while ((eol = conn.input.find('\n')) != std::string::npos) {
+        std::string line = conn.input.substr(0, eol);
+        conn.input.erase(0, eol + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!conn.closing)
+            handleCommand(id, conn, line, pool);
+    }
+    return true;
+}
+
+static bool writeConnection(TConnection &conn)
+{
+    while (!conn.output.empty()) {
+        ssize_t n = write(conn.outFd, conn.output.data(), conn.output.size());
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return true;
+        if (n <= 0)
+            return false;
+        conn.output.erase(0, static_cast<size_t>(n));
+    }
+    return true;
+}
+
+static void closeConnection(int id)
+{
+    TConnection &conn = connections[id];
+    // Searches still running for it finish unseen
+    stopSearches(conn);
+    if (conn.inFd > STDERR_FILENO)
+        close(conn.inFd);
+    connections.erase(id);
+}
+
+static int addConnection(int inFd, int outFd)
+{
+    TConnection &conn = connections[nextConnection];
+    conn.inFd = inFd;
+    conn.outFd = outFd;
+    conn.searches = 0;
+    conn.closing = false;
+    return nextConnection++;
+}
+
+static int listenSocket(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+/****************************************************************************
+ * The event loop. Runs until there is no listening socket and every
+ * connection has closed.
+ */
+static void serve(int listenFd, TWorkerPool &pool)
+{
+    std::vector<struct pollfd> fds;
+    std::vector<int> ids;   // connection of each entry in fds, -1 for the others
+    std::vector<TSearchReply> replies;
+
+    while (listenFd >= 0 || !connections.empty()) {
+        fds.clear();
+        ids.clear();
+        fds.push_back({pool.wakeFd(), POLLIN, 0});
+        ids.push_back(-1);
+        if (listenFd >= 0) {
+            fds.push_back({listenFd, POLLIN, 0});
+            ids.push_back(-1);
+        }
+        for (auto &entry : connections) {
+            TConnection &conn = entry.second;
+            if (!conn.closing) {
+                fds.push_back({conn.inFd, POLLIN, 0});
+                ids.push_back(entry.first);
+            }
+            if (!conn.output.empty()) {
+                fds.push_back({conn.outFd, POLLOUT, 0});
+                ids.push_back(entry.first);
+            }
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            return;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            pool.takeReplies(replies);
+            for (const TSearchReply &reply : replies) {
+                auto it = connections.find(reply.connection);
+                if (it == connections.end())
+                    continue; // closed while searching
+                TConnection &conn = it->second;
+                conn.searches--;
+                auto game = conn.games.find(reply.gameId);
+                if (game != conn.games.end())
+                    game->second.stop.reset();
+                send(conn, reply.text);
+            }
+        }
+        if (listenFd >= 0 && (fds[1].revents & POLLIN)) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd >= 0) {
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                addConnection(fd, fd);
+            }
+        }
+        for (size_t idx = 0; idx < fds.size(); idx++) {
+            int id = ids[idx];
+            auto it = connections.find(id);
+            if (id < 0 || it == connections.end() || !fds[idx].revents)
+                continue;
+            TConnection &conn = it->second;
+            bool ok = true;
+            if (fds[idx].events == POLLIN && (fds[idx].revents & (POLLIN | POLLHUP | POLLERR))) {
+                if (!readConnection(id, conn, pool)) {
+                    // End of input, no stop can follow for searches without
+                    // limits. The others run to their limits before closing.
+                    conn.closing = true;
+                    stopSearches(conn, true);
+                }
+            } else if (fds[idx].events == POLLOUT) {
+                ok = (fds[idx].revents & POLLOUT) && writeConnection(conn);
+            }
+            if (!ok)
+                closeConnection(id);
+        }
+        // Write what is ready at once, most writes don't need to wait
+        for (auto it = connections.begin(); it != connections.end();) {
+            TConnection &conn = it->second;
+            int id = it->first;
+            ++it;
+            if (!writeConnection(conn))
+                closeConnection(id);
+            else if (conn.closing && conn.searches == 0 && conn.output.empty())
+                closeConnection(id);
+        }
+    }
+} // serve
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--socket path] [--no-stdin] [--workers count] [--hash MB] [--threads count]\n"
+                    "       [--shared-hash name] [--tablebase path] [--book path] [--weights path]\n", program);
+}
+
+int main(int argc, char *argv[])
+{
+    TServerOptions options = {nullptr, true, static_cast<int>(std::thread::hardware_concurrency()),
+                              DefaultEngineConfig, nullptr, nullptr, nullptr};
+    const char *weights = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-stdin") == 0) {
+            options.useStdin = false;
+        } else if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        } else if (strcmp(argv[i], "--socket") == 0) {
+            options.socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--workers") == 0) {
+            options.workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--hash") == 0) {
+            options.engine.hashMegabytes = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            options.engine.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tablebase") == 0) {
+            options.tablebase = argv[++i];
+        } else if (strcmp(argv[i], "--shared-hash") == 0) {
+            options.sharedHash = argv[++i];
+        } else if (strcmp(argv[i], "--book") == 0) {
+            options.book = argv[++i];
+        } else if (strcmp(argv[i], "--weights") == 0) {
+            weights = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.workers < 1)
+        options.workers = 1;
+    if (weights && !loadEvalWeights(weights)) {
+        fprintf(stderr, "Can't read evaluation weights %s\n", weights);
+        return 1;
+    }
+    if (options.sharedHash) {
+        // Make the segment now, so the workers all find it
+        TTranspositionTable table(0);
+        if (!table.openShared(options.sharedHash, options.engine.hashMegabytes, TAmerican::VariantId)) {
+            fprintf(stderr, "Can't open shared hash %s\n", options.sharedHash);
+            return 1;
+        }
+    }
+    if (!options.useStdin && !options.socketPath) {
+        fprintf(stderr, "Nothing to serve, give --socket or leave stdin on\n");
+        return 1;
+    }
+    // A client that goes away mid-write must not end the server
+    signal(SIGPIPE, SIG_IGN);
+
+    int listenFd = -1;
+    if (options.socketPath) {
+        listenFd = listenSocket(options.socketPath);
+        if (listenFd < 0)
+            return 1;
+    }
+    TWorkerPool pool(options);
+    if (options.useStdin)
+        addConnection(STDIN_FILENO, STDOUT_FILENO);
+    serve(listenFd, pool);
+
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(options.socketPath);
+    }
+    return 0;
+} // main
@@ -0,0 +1,229 @@
+/****************************************************************************
+* Endgame tablebase: position numbering and the memory mapped probe.
+****************************************************************************/
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tablebase.h"
+
+// Squares a man can stand on, all but the row where it would be crowned
+static const int ManSquares = 28;
+// Lowest square a red man can stand on
+static const int RedManOffset = 4;
+
+struct TChoose {
+    uint64_t n[Squares + 1][MaxTablebasePieces + 1];
+};
+
+constexpr TChoose makeChoose()
+{
+    TChoose c = {};
+    for (int n = 0; n <= Squares; n++) {
+        c.n[n][0] = 1;
+        for (int k = 1; k <= MaxTablebasePieces && k <= n; k++)
+            c.n[n][k] = c.n[n - 1][k - 1] + ((k < n) ? c.n[n - 1][k] : 0);
+    }
+    return c;
+}
+
+// Choose.n[n][k] is the number of ways to pick k of n squares
+static constexpr TChoose Choose = makeChoose();
+
+/****************************************************************************
+ * Number a set of squares with the combinatorial number system.
+ * @param mask - The squares
+ * @param offset - Lowest square that may be in the set
+ * @return
+ */
+static uint64_t rankSquares(uint32_t mask, int offset)
+{
+    uint64_t rank = 0;
+    for (int k = 1; mask; k++, mask &= mask - 1)
+        rank += Choose.n[firstSquare(mask) - offset][k];
+    return rank;
+}
+
+/****************************************************************************
+ * Inverse of rankSquares().
+ * @param rank
+ * @param count - Squares in the set
+ * @param slots - Squares the set is picked from
+ * @param offset
+ * @return The set of squares.
+ */
+static uint32_t unrankSquares(uint64_t rank, int count, int slots, int offset)
+{
+    uint32_t mask = 0;
+    int c = slots - 1;
+    for (int k = count; k > 0; k--) {
+        while (Choose.n[c][k] > rank)
+            c--;
+        rank -= Choose.n[c][k];
+        mask |= squareMask(c + offset);
+        c--;
+    }
+    return mask;
+}
+
+/****************************************************************************
+ * Count the men and kings of each side.
+ * @param board
+ * @return
+ */
+TMaterial materialCount(const TBoard &board)
+{
+    TMaterial material;
+    for (int side = Black; side <= Red; side++) {
+        material.men[side] = bitCount(board.pieces[side] & ~board.kings);
+        material.kings[side] = bitCount(board.pieces[side] & board.kings);
+    }
+    return material;
+}
+
+/****************************************************************************
+ * Number of positions in a material group, for both sides to move.
+ * @param material
+ * @return
+ */
+uint64_t tablebaseSize(const TMaterial &material)
+{
+    return Choose.n[ManSquares][material.men[Black]] * Choose.n[ManSquares][material.men[Red]]
+           * Choose.n[Squares][material.kings[Black]] * Choose.n[Squares][material.kings[Red]] * 2;
+}
+
+/****************************************************************************
+ * Number a position within its material group.
+ * @param board
+ * @param side - Side to move
+ * @param material - materialCount() of the board
+ * @return
+ */
+uint64_t tablebaseIndex(const TBoard &board, int side, const TMaterial &material)
+{
+    uint64_t index = rankSquares(board.pieces[Black] & ~board.kings, 0);
+    index = index * Choose.n[ManSquares][material.men[Red]] + rankSquares(board.pieces[Red] & ~board.kings,
+                                                                          RedManOffset);
+    index = index * Choose.n[Squares][material.kings[Black]] + rankSquares(board.pieces[Black] & board.kings, 0);
+    index = index * Choose.n[Squares][material.kings[Red]] + rankSquares(board.pieces[Red] & board.kings, 0);
+    return index * 2 + side;
+}
+
+/****************************************************************************
+ * Inverse of tablebaseIndex().
+ * @param material
+ * @param index
+ * @param board - Set to the position
+ * @param side - Set to the side to move
+ * @return false if the number is unused because two pieces share a square.
+ */
+bool tablebasePosition(const TMaterial &material, uint64_t index, TBoard &board, int &side)
+{
+    side = static_cast<int>(index % 2);
+    index /= 2;
+    uint64_t count = Choose.n[Squares][material.kings[Red]];
+    uint32_t redKings = unrankSquares(index % count, material.kings[Red], Squares, 0);
+    index /= count;
+    count = Choose.n[Squares][material.kings[Black]];
+    uint32_t blackKings = unrankSquares(index % count, material.kings[Black], Squares, 0);
+    index /= count;
+    count = Choose.n[ManSquares][material.men[Red]];
+    uint32_t redMen = unrankSquares(index % count, material.men[Red], ManSquares, RedManOffset);
+    index /= count;
+    uint32_t blackMen = unrankSquares(index, material.men[Black], ManSquares, 0);
+
+    uint32_t kings = blackKings | redKings;
+    uint32_t all = blackMen | redMen | kings;
+    if (bitCount(all) != bitCount(blackMen) + bitCount(redMen) + bitCount(blackKings) + bitCount(redKings))
+        return false;
+    board = makeBoard(blackMen | blackKings, redMen | redKings, kings);
+    return true;
+} // tablebasePosition
+
+TTablebase::TTablebase()
+        : data(nullptr), length(0), pieces(0)
+{
+    memset(groups, 0, sizeof(groups));
+}
+
+TTablebase::~TTablebase()
+{
+    close();
+}
+
+/****************************************************************************
+ * Map a tablebase file into memory, replacing any open one.
+ * @param path
+ * @return false if the file can't be read or isn't a tablebase.
+ */
+bool TTablebase::open(const char *path)
+{
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TTablebaseHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    data = static_cast<const uint8_t *>(map);
+    length = static_cast<size_t>(st.st_size);
+
+    TTablebaseHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != TablebaseMagic || header.version != TablebaseVersion ||
+        header.maxPieces > MaxTablebasePieces ||
+        length < sizeof(header) + header.groups * sizeof(TTablebaseGroup)) {
+        close();
+        return false;
+    }
+    for (uint32_t idx = 0; idx < header.groups; idx++) {
+        TTablebaseGroup group;
+        memcpy(&group, data + sizeof(header) + idx * sizeof(group), sizeof(group));
+        TMaterial material = {{group.men[Black], group.men[Red]}, {group.kings[Black], group.kings[Red]}};
+        if (group.men[Black] + group.men[Red] + group.kings[Black] + group.kings[Red] > static_cast<int>(header.maxPieces) ||
+            group.size != tablebaseSize(material) || group.offset > length || group.size > length - group.offset) {
+            close();
+            return false;
+        }
+        groups[group.men[Black]][group.kings[Black]][group.men[Red]][group.kings[Red]] = data + group.offset;
+    }
+    pieces = static_cast<int>(header.maxPieces);
+    return true;
+} // open
+
+void TTablebase::close()
+{
+    if (data)
+        munmap(const_cast<uint8_t *>(data), length);
+    data = nullptr;
+    length = 0;
+    pieces = 0;
+    memset(groups, 0, sizeof(groups));
+}
+
+/****************************************************************************
+ * Look up a position at the start of a turn.
+ * @param board
+ * @param side - Side to move
+ * @param value - Set to the table value when found, see tablebaseValue()
+ * @return false if the position has too many pieces for the table.
+ */
+bool TTablebase::probe(const TBoard &board, int side, uint8_t &value) const
+{
+    if (bitCount(board.pieces[Black] | board.pieces[Red]) > pieces ||
+        !board.pieces[Black] || !board.pieces[Red])
+        return false;
+    TMaterial material = materialCount(board);
+    const uint8_t *group = groups[material.men[Black]][material.kings[Black]][material.men[Red]][material.kings[Red]];
+    if (!group)
+        return false;
+    value = group[tablebaseIndex(board, side, material)];
+    return true;
+}
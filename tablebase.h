@@ -0,0 +1,129 @@
+/****************************************************************************
+* Endgame tablebase.
+*
+* A tablebase holds the exact result of every position with a few pieces:
+* win, loss or draw for the side to move, and for wins and losses the
+* number of plies to the end of the game with best play. It is built by
+* checkers_tbgen and read by mapping the file into memory, so any number
+* of engines can share one copy.
+*
+* Positions are grouped by material, the count of men and kings of each
+* side. Within a group a position is numbered from the squares of each kind
+* of piece using the combinatorial number system. Black men are never on
+* row 8 and red men never on row 1, so men are numbered over 28 squares and
+* kings over all 32. Numbers where two pieces share a square are unused.
+*
+* Only positions at the start of a turn are stored. A multiple jump is one
+* move, as in play.
+*
+* File layout, all integers little endian:
+*   header      TTablebaseHeader
+*   directory   TTablebaseGroup for each group
+*   data        one byte per position for each group, see TTablebase
+****************************************************************************/
+#ifndef CHECKERS_TABLEBASE_H
+#define CHECKERS_TABLEBASE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+
+// Most pieces a tablebase can hold
+const int MaxTablebasePieces = 8;
+
+const uint32_t TablebaseMagic = 0x42544B43; // "CKTB"
+const uint32_t TablebaseVersion = 1;
+
+// Value of a drawn position, see tablebaseValue()
+const uint8_t TablebaseDraw = 0;
+// Longest distance a value can hold
+const int MaxTablebasePlies = 254;
+
+// Men and kings of each side
+struct TMaterial {
+    int men[2];
+    int kings[2];
+};
+
+struct TTablebaseHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t maxPieces;
+    uint32_t groups;
+};
+
+struct TTablebaseGroup {
+    uint8_t men[2];
+    uint8_t kings[2];
+    uint32_t reserved;
+    uint64_t offset;    // from the start of the file
+    uint64_t size;      // positions, two for each placement of the pieces
+};
+
+TMaterial materialCount(const TBoard &board);
+
+uint64_t tablebaseSize(const TMaterial &material);
+
+uint64_t tablebaseIndex(const TBoard &board, int side, const TMaterial &material);
+
+bool tablebasePosition(const TMaterial &material, uint64_t index, TBoard &board, int &side);
+
+/****************************************************************************
+ * Table values: 0 is a draw, otherwise the value is the distance to the end
+ * in plies plus one. Wins are an odd number of plies away, so even values
+ * are wins and odd values are losses for the side to move.
+ */
+inline uint8_t tablebaseValue(int plies)
+{
+    return static_cast<uint8_t>(plies + 1);
+}
+
+inline bool tablebaseWin(uint8_t value)
+{
+    return value != TablebaseDraw && (value & 1) == 0;
+}
+
+inline bool tablebaseLoss(uint8_t value)
+{
+    return (value & 1) != 0;
+}
+
+inline int tablebasePlies(uint8_t value)
+{
+    return value - 1;
+}
+
+/****************************************************************************
+ * A tablebase file mapped into memory. Probing is read only and safe from
+ * any number of threads.
+ */
+class TTablebase {
+public:
+    TTablebase();
+
+    ~TTablebase();
+
+    TTablebase(const TTablebase &) = delete;
+
+    TTablebase &operator=(const TTablebase &) = delete;
+
+    bool open(const char *path);
+
+    void close();
+
+    int maxPieces() const
+    {
+        return pieces;
+    }
+
+    bool probe(const TBoard &board, int side, uint8_t &value) const;
+
+private:
+    const uint8_t *data;
+    size_t length;
+    int pieces;         // 0 when no file is open
+    // Data of each group, indexed by men and kings of each side
+    const uint8_t *groups[MaxTablebasePieces + 1][MaxTablebasePieces + 1][MaxTablebasePieces + 1][MaxTablebasePieces + 1];
+};
+
+#endif // CHECKERS_TABLEBASE_H
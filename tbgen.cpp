@@ -0,0 +1,312 @@
+/****************************************************************************
+* Endgame tablebase generator.
+*
+* Builds a tablebase of every position with up to a given number of pieces
+* by retrograde analysis, one material group at a time. Groups are built in
+* order of fewer pieces, then fewer men, so that every position a capture
+* or a crowning leads to is already known.
+*
+* Within a group the results are found one distance at a time. Pass 0 marks
+* the positions where the side to move has no moves as lost. Pass n marks a
+* position won in n plies when a move reaches a position lost in n - 1, and
+* lost in n plies when every move reaches a won position and the slowest of
+* those wins is n - 1 plies. Positions never marked are draws. Each pass is
+* split over several threads, which read the table and queue their results
+* to be written once the pass is done.
+*
+* A group with the sides' pieces swapped is the same group seen from the
+* other side of the board, so only one of each such pair is searched and
+* the other is copied from it.
+*
+* Options:
+*   --pieces <count>    Most pieces on the board (default 4)
+*   --output <path>     File to write (default endgame.tb)
+*   --threads <count>   Threads for each pass (default: hardware threads)
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "tablebase.h"
+
+struct TGroupTable {
+    TMaterial material;
+    std::vector<uint8_t> values;
+};
+
+// Tables built so far, indexed by men and kings of each side
+static TGroupTable *tables[MaxTablebasePieces + 1][MaxTablebasePieces + 1][MaxTablebasePieces + 1][MaxTablebasePieces + 1];
+
+/****************************************************************************
+ * Call visit with the board after each move for the side.
+ * @return The number of moves.
+ */
+template <class TVisit>
+static int forEachTurn(TBoard &board, int side, TVisit &visit)
+{
+    TMoveList moves;
+    TUndo undo;
+
+    getValidMoves(board, side, moves);
+    for (TMove move : moves) {
+        makeMove(board, move, undo);
+        visit(board);
+        unmakeMove(board, move, undo);
+    }
+    return moves.size();
+}
+
+/****************************************************************************
+ * Table value of a position reached by a turn, from the point of view of
+ * the side to move in it.
+ */
+static uint8_t lookup(const TBoard &board, int side)
+{
+    if (!board.pieces[side])
+        return tablebaseValue(0); // no pieces, no moves
+    TMaterial m = materialCount(board);
+    const TGroupTable *table = tables[m.men[Black]][m.kings[Black]][m.men[Red]][m.kings[Red]];
+    return table->values[tablebaseIndex(board, side, m)];
+}
+
+/****************************************************************************
+ * Find the value a position gets in a pass, if any.
+ * @param table - Group being built
+ * @param index - Position to look at, not yet marked
+ * @param pass - Distance being marked
+ * @param value - Set to the new value
+ * @return true if the position is won or lost in exactly pass plies.
+ */
+static bool passValue(const TGroupTable &table, uint64_t index, int pass, uint8_t &value)
+{
+    TBoard board;
+    int side;
+    if (!tablebasePosition(table.material, index, board, side))
+        return false;
+
+    int fastestWin = MaxTablebasePlies + 1;
+    int slowestLoss = 0;
+    bool allWon = true;
+    auto visit = [&](const TBoard &child) {
+        uint8_t v = lookup(child, side ^ 1);
+        if (tablebaseLoss(v)) {
+            if (tablebasePlies(v) + 1 < fastestWin)
+                fastestWin = tablebasePlies(v) + 1;
+        } else if (tablebaseWin(v)) {
+            if (tablebasePlies(v) + 1 > slowestLoss)
+                slowestLoss = tablebasePlies(v) + 1;
+        } else {
+            allWon = false; // a draw, or not known yet
+        }
+    };
+    if (forEachTurn(board, side, visit) == 0) {
+        if (pass != 0)
+            return false; // marked in pass 0
+        value = tablebaseValue(0);
+        return true;
+    }
+    if (fastestWin == pass) {
+        value = tablebaseValue(pass);
+        return true;
+    }
+    if (fastestWin > MaxTablebasePlies && allWon && slowestLoss == pass) {
+        value = tablebaseValue(pass);
+        return true;
+    }
+    return false;
+} // passValue
+
+// Move square n of the mask to square 31 - n
+static uint32_t reverseSquares(uint32_t mask)
+{
+    mask = ((mask >> 1) & 0x55555555) | ((mask & 0x55555555) << 1);
+    mask = ((mask >> 2) & 0x33333333) | ((mask & 0x33333333) << 2);
+    mask = ((mask >> 4) & 0x0F0F0F0F) | ((mask & 0x0F0F0F0F) << 4);
+    mask = ((mask >> 8) & 0x00FF00FF) | ((mask & 0x00FF00FF) << 8);
+    return (mask >> 16) | (mask << 16);
+}
+
+/****************************************************************************
+ * Turn the board around and swap the colors of the pieces.
+ */
+static TBoard flipBoard(const TBoard &board)
+{
+    return makeBoard(reverseSquares(board.pieces[Red]), reverseSquares(board.pieces[Black]),
+                     reverseSquares(board.kings));
+}
+
+/****************************************************************************
+ * Fill a group from its mirror image, already built.
+ */
+static void copyMirror(TGroupTable &table, const TGroupTable &mirror)
+{
+    table.values.assign(tablebaseSize(table.material), TablebaseDraw);
+    for (uint64_t index = 0; index < table.values.size(); index++) {
+        TBoard board;
+        int side;
+        if (tablebasePosition(table.material, index, board, side))
+            table.values[index] = mirror.values[tablebaseIndex(flipBoard(board), side ^ 1, mirror.material)];
+    }
+}
+
+/****************************************************************************
+ * Run one pass over part of a group.
+ */
+static void runPass(const TGroupTable &table, int pass, uint64_t first, uint64_t step,
+                    std::vector<std::pair<uint64_t, uint8_t>> &updates)
+{
+    uint8_t value;
+    for (uint64_t index = first; index < table.values.size(); index += step) {
+        if (table.values[index] == TablebaseDraw && passValue(table, index, pass, value))
+            updates.emplace_back(index, value);
+    }
+}
+
+/****************************************************************************
+ * Build the table for one group. Every group a capture or crowning leads
+ * to must already be built.
+ * @param table - values are filled in
+ * @param threads
+ * @param knownPlies - Longest distance in the groups built so far, updated
+ *                     with this group's
+ */
+static void buildGroup(TGroupTable &table, int threads, int &knownPlies)
+{
+    uint64_t size = tablebaseSize(table.material);
+    table.values.assign(size, TablebaseDraw);
+    std::vector<std::vector<std::pair<uint64_t, uint8_t>>> updates(threads);
+
+    int longest = 0;
+    for (int pass = 0; pass <= MaxTablebasePlies; pass++) {
+        std::vector<std::thread> workers;
+        for (int id = 0; id < threads; id++) {
+            updates[id].clear();
+            workers.emplace_back(runPass, std::cref(table), pass, static_cast<uint64_t>(id),
+                                 static_cast<uint64_t>(threads), std::ref(updates[id]));
+        }
+        bool changed = false;
+        for (int id = 0; id < threads; id++) {
+            workers[id].join();
+            for (const std::pair<uint64_t, uint8_t> &update : updates[id])
+                table.values[update.first] = update.second;
+            changed = changed || !updates[id].empty();
+        }
+        if (changed)
+            longest = pass;
+        // Nothing can be marked once the passes are past every known distance
+        else if (pass > knownPlies + 1 && pass > longest + 1)
+            break;
+        if (pass == MaxTablebasePlies && changed) {
+            fprintf(stderr, "Distance to the end is too long for the table\n");
+            exit(1);
+        }
+    }
+    if (longest > knownPlies)
+        knownPlies = longest;
+} // buildGroup
+
+static void describe(const TMaterial &m, char *text, size_t size)
+{
+    snprintf(text, size, "%dm%dk v %dm%dk", m.men[Black], m.kings[Black], m.men[Red], m.kings[Red]);
+}
+
+int main(int argc, char *argv[])
+{
+    int maxPieces = 4;
+    const char *output = "endgame.tb";
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--pieces") == 0 && i + 1 < argc) {
+            maxPieces = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--pieces count] [--output path] [--threads count]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (maxPieces < 2 || maxPieces > MaxTablebasePieces) {
+        fprintf(stderr, "Pieces must be 2 to %d\n", MaxTablebasePieces);
+        return 1;
+    }
+    if (threads < 1)
+        threads = 1;
+
+    // Fewer pieces first, then fewer men, so captures and crownings lead to built groups
+    std::vector<TGroupTable *> order;
+    for (int pieces = 2; pieces <= maxPieces; pieces++) {
+        for (int men = 0; men <= pieces; men++) {
+            for (int bm = 0; bm <= men; bm++) {
+                int rm = men - bm;
+                for (int bk = 0; bk <= pieces - men; bk++) {
+                    int rk = pieces - men - bk;
+                    if (bm + bk == 0 || rm + rk == 0)
+                        continue;
+                    TGroupTable *table = new TGroupTable;
+                    table->material = {{bm, rm}, {bk, rk}};
+                    tables[bm][bk][rm][rk] = table;
+                    order.push_back(table);
+                }
+            }
+        }
+    }
+
+    int knownPlies = 0;
+    for (TGroupTable *table : order) {
+        const TMaterial &m = table->material;
+        const TGroupTable *mirror = tables[m.men[Red]][m.kings[Red]][m.men[Black]][m.kings[Black]];
+        auto start = std::chrono::steady_clock::now();
+        if (mirror != table && !mirror->values.empty())
+            copyMirror(*table, *mirror);
+        else
+            buildGroup(*table, threads, knownPlies);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        uint64_t wins = 0, losses = 0;
+        int longest = 0;
+        for (uint8_t value : table->values) {
+            wins += tablebaseWin(value);
+            losses += tablebaseLoss(value);
+            if (value != TablebaseDraw && tablebasePlies(value) > longest)
+                longest = tablebasePlies(value);
+        }
+        char name[32];
+        describe(table->material, name, sizeof(name));
+        fprintf(stderr, "%-14s %12llu positions %12llu wins %12llu losses %4d longest %8.2fs\n", name,
+                static_cast<unsigned long long>(table->values.size()), static_cast<unsigned long long>(wins),
+                static_cast<unsigned long long>(losses), longest, elapsed.count());
+    }
+
+    FILE *file = fopen(output, "wb");
+    if (!file) {
+        perror(output);
+        return 1;
+    }
+    TTablebaseHeader header = {TablebaseMagic, TablebaseVersion, static_cast<uint32_t>(maxPieces),
+                               static_cast<uint32_t>(order.size())};
+    fwrite(&header, sizeof(header), 1, file);
+    uint64_t offset = sizeof(header) + order.size() * sizeof(TTablebaseGroup);
+    for (const TGroupTable *table : order) {
+        const TMaterial &m = table->material;
+        TTablebaseGroup group = {{static_cast<uint8_t>(m.men[Black]), static_cast<uint8_t>(m.men[Red])},
+                                 {static_cast<uint8_t>(m.kings[Black]), static_cast<uint8_t>(m.kings[Red])},
+                                 0, offset, table->values.size()};
+        fwrite(&group, sizeof(group), 1, file);
+        offset += table->values.size();
+    }
+    for (const TGroupTable *table : order)
+        fwrite(table->values.data(), 1, table->values.size(), file);
+    if (fclose(file) != 0) {
+        perror(output);
+        return 1;
+    }
+    for (TGroupTable *table : order)
+        delete table;
+    return 0;
+} // main
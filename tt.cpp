@@ -0,0 +1,298 @@
+/****************************************************************************
+* Transposition table.
+****************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <thread>
+#include "tt.h"
+
+// Other processes read and write the entries of a shared table, which is
+// only safe when the atomics are plain lock-free words
+#if __cplusplus >= 201703L
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared tables need lock-free 64 bit atomics");
+#else
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "shared tables need lock-free 64 bit atomics");
+#endif
+
+// Start of a shared table's segment, followed by the buckets
+struct alignas(64) TTHeader {
+    std::atomic<uint64_t> magic;    // sharedMagic() once the header is filled in
+    uint64_t bucketCount;
+};
+
+// How long to wait for the process creating a shared table to set it up
+static const int SharedSetupMs = 2000;
+
+/****************************************************************************
+ * Mark of a shared table: "CKTT", the layout version, the rules variant
+ * and the bucket size, so that processes built with another layout or
+ * searching another variant don't share a segment.
+ */
+static uint64_t sharedMagic(int variant)
+{
+    return (0x434B5454ull << 32) | (2u << 16) | (static_cast<uint64_t>(variant) << 8) | sizeof(TTBucket);
+}
+
+/****************************************************************************
+ * Entry data layout: move in bits 0-15, score in bits 16-31, depth in bits
+ * 32-39, bound in bits 40-47 and age in bits 48-55.
+ */
+static inline uint64_t packEntry(uint16_t move, int score, int depth, int bound, uint8_t age)
+{
+    return static_cast<uint64_t>(move)
+           | (static_cast<uint64_t>(static_cast<uint16_t>(score)) << 16)
+           | (static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 32)
+           | (static_cast<uint64_t>(bound) << 40)
+           | (static_cast<uint64_t>(age) << 48);
+}
+
+static inline TTEntry unpackEntry(uint64_t data)
+{
+    TTEntry entry;
+    entry.move = static_cast<uint16_t>(data);
+    entry.score = static_cast<int16_t>(data >> 16);
+    entry.depth = static_cast<int8_t>(data >> 32);
+    entry.bound = static_cast<uint8_t>(data >> 40);
+    entry.age = static_cast<uint8_t>(data >> 48);
+    return entry;
+}
+
+/****************************************************************************
+ * Number of buckets for a table size, rounded down to a power of two so
+ * the key can be masked to a bucket index.
+ */
+static size_t bucketsFor(size_t megabytes)
+{
+    size_t count = 1;
+    size_t bytes = megabytes * 1024 * 1024;
+    while (count * 2 * sizeof(TTBucket) <= bytes)
+        count *= 2;
+    return count;
+}
+
+TTranspositionTable::TTranspositionTable(size_t megabytes)
+        : memory(nullptr), mappedBytes(0), buckets(nullptr), bucketCount(0), age(0)
+{
+    resize(megabytes);
+}
+
+TTranspositionTable::~TTranspositionTable()
+{
+    release();
+}
+
+void TTranspositionTable::release()
+{
+    if (mappedBytes)
+        munmap(memory, mappedBytes);
+    else
+        free(memory);
+    memory = nullptr;
+    mappedBytes = 0;
+    buckets = nullptr;
+    bucketCount = 0;
+}
+
+/****************************************************************************
+ * Reallocate the table as a private table, clearing it. A shared table is
+ * left to the other processes using it. Must not be called while a search
+ * is running.
+ * @param megabytes
+ */
+void TTranspositionTable::resize(size_t megabytes)
+{
+    size_t count = bucketsFor(megabytes);
+
+    release();
+    // Over allocate so the buckets can start on a cache line
+    memory = malloc(count * sizeof(TTBucket) + alignof(TTBucket));
+    if (!memory)
+        throw std::bad_alloc();
+    uintptr_t addr = reinterpret_cast<uintptr_t>(memory);
+    addr = (addr + alignof(TTBucket) - 1) & ~static_cast<uintptr_t>(alignof(TTBucket) - 1);
+    buckets = new(reinterpret_cast<void *>(addr)) TTBucket[count];
+    bucketCount = count;
+    clear();
+} // resize
+
+/****************************************************************************
+ * Use a table in a named shared memory segment, creating it with the given
+ * size if there is none, otherwise using it as it is with the size it was
+ * made with. Must not be called while a search is running.
+ * @param name - Segment name, such as "/checkers", a / is put in front if
+ *               it has none
+ * @param megabytes - Table size for a new segment
+ * @param variant - VariantId of the rules variant searched
+ * @return false if the segment can't be opened or created, or was made by
+ *         a different version of the table or for another variant. The
+ *         table is then unchanged.
+ */
+bool TTranspositionTable::openShared(const char *name, size_t megabytes, int variant)
+{
+    const uint64_t magic = sharedMagic(variant);
+    std::string path = (name[0] == '/') ? name : std::string("/") + name;
+    size_t count = bucketsFor(megabytes);
+    size_t bytes = sizeof(TTHeader) + count * sizeof(TTBucket);
+    bool created = true;
+
+    int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        created = false;
+        fd = shm_open(path.c_str(), O_RDWR, 0600);
+    }
+    if (fd < 0)
+        return false;
+    if (created) {
+        // The new segment reads as zeros, which are empty entries
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            shm_unlink(path.c_str());
+            return false;
+        }
+    } else {
+        // Wait for the process that made it to set its size
+        struct stat st;
+        for (int waited = 0;; waited++) {
+            if (fstat(fd, &st) != 0 || waited >= SharedSetupMs) {
+                ::close(fd);
+                return false;
+            }
+            if (static_cast<size_t>(st.st_size) >= sizeof(TTHeader))
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        bytes = static_cast<size_t>(st.st_size);
+    }
+    void *map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    TTHeader *shared = static_cast<TTHeader *>(map);
+    if (created) {
+        shared->bucketCount = count;
+        shared->magic.store(magic, std::memory_order_release);
+    } else {
+        for (int waited = 0; shared->magic.load(std::memory_order_acquire) != magic; waited++) {
+            if (shared->magic.load(std::memory_order_relaxed) != 0 || waited >= SharedSetupMs) {
+                munmap(map, bytes);
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        count = static_cast<size_t>(shared->bucketCount);
+        if (count == 0 || (count & (count - 1)) != 0 || sizeof(TTHeader) + count * sizeof(TTBucket) > bytes) {
+            munmap(map, bytes);
+            return false;
+        }
+    }
+
+    release();
+    memory = map;
+    mappedBytes = bytes;
+    buckets = reinterpret_cast<TTBucket *>(static_cast<uint8_t *>(map) + sizeof(TTHeader));
+    bucketCount = count;
+    // Every entry keeps age 0, see newSearch()
+    age.store(0, std::memory_order_relaxed);
+    return true;
+} // openShared
+
+/****************************************************************************
+ * Empty the table. A shared table is left as it is, other processes may
+ * be using its entries.
+ */
+void TTranspositionTable::clear()
+{
+    if (isShared())
+        return;
+    for (size_t idx = 0; idx < bucketCount; idx++) {
+        for (TTSlot &slot : buckets[idx].slots) {
+            slot.check.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    age.store(0, std::memory_order_relaxed);
+}
+
+/****************************************************************************
+ * Start a new search. Entries left from earlier searches are replaced
+ * first. A shared table isn't aged: a search in another process can't tell
+ * this one's entries from its own, and would replace them first.
+ */
+void TTranspositionTable::newSearch()
+{
+    if (isShared())
+        return;
+    // Entries stored 256 searches ago would look current once the age wraps
+    if (age.fetch_add(1, std::memory_order_relaxed) == UINT8_MAX)
+        clear();
+}
+
+/****************************************************************************
+ * Look up a position.
+ * @param key
+ * @param entry - Set to the stored entry when found
+ * @return true if the position was found.
+ */
+bool TTranspositionTable::probe(uint64_t key, TTEntry &entry) const
+{
+    const TTBucket &bucket = buckets[key & (bucketCount - 1)];
+    for (const TTSlot &slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+        if ((check ^ data) == key) {
+            entry = unpackEntry(data);
+            if (entry.bound != BoundNone)
+                return true;
+        }
+    }
+    return false;
+}
+
+/****************************************************************************
+ * Store a search result. The entry for the same position is replaced if
+ * there is one, otherwise the shallowest entry, preferring entries from
+ * older searches.
+ * @param key
+ * @param depth
+ * @param bound
+ * @param score
+ * @param move - TMove::packed of the best move, 0 when there is none
+ */
+void TTranspositionTable::store(uint64_t key, int depth, int bound, int score, uint16_t move)
+{
+    TTBucket &bucket = buckets[key & (bucketCount - 1)];
+    uint8_t current = age.load(std::memory_order_relaxed);
+    TTSlot *replace = nullptr;
+    int worst = 0;
+
+    for (TTSlot &slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        TTEntry e = unpackEntry(data);
+        if ((slot.check.load(std::memory_order_relaxed) ^ data) == key) {
+            // Keep a deeper result from this search
+            if (e.age == current && e.depth > depth && bound != BoundExact)
+                return;
+            if (!move)
+                move = e.move;
+            replace = &slot;
+            break;
+        }
+        int value = e.depth - ((e.age == current) ? 0 : 256);
+        if (!replace || value < worst) {
+            replace = &slot;
+            worst = value;
+        }
+    }
+    uint64_t data = packEntry(move, score, depth, bound, current);
+    replace->check.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+} // store
@@ -0,0 +1,95 @@
+/****************************************************************************
+* Transposition table.
+*
+* A fixed size hash table of search results. Entries are grouped four to a
+* 64 byte bucket so a probe touches a single cache line.
+*
+* The table is shared by all search threads without locks. Each entry is
+* two 64 bit words, the packed data and the key xor'ed with the data. A
+* reader that sees half of a concurrent write gets a key that doesn't match
+* and treats the entry as a miss.
+*
+* The same holds between processes: openShared() maps the table from a
+* named POSIX shared memory segment, so engines in several processes on
+* one machine share their results. The first process to open a segment
+* creates it with its table size, the others use the size it was made
+* with. A segment holds the positions of one rules variant. Searches in
+* other processes start and end at any time, so a shared table isn't aged
+* and its entries are replaced by depth alone. A segment lasts until it is
+* removed from /dev/shm or the machine restarts.
+****************************************************************************/
+#ifndef CHECKERS_TT_H
+#define CHECKERS_TT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "board.h"
+
+enum TBound {
+    BoundNone, BoundUpper, BoundLower, BoundExact
+};
+
+// Unpacked contents of a table entry
+struct TTEntry {
+    uint16_t move;   // TMove::packed, 0 for none
+    int16_t score;
+    int8_t depth;
+    uint8_t bound;
+    uint8_t age;
+};
+
+struct TTSlot {
+    std::atomic<uint64_t> check; // key ^ data
+    std::atomic<uint64_t> data;
+};
+
+const int BucketEntries = 4;
+
+struct alignas(64) TTBucket {
+    TTSlot slots[BucketEntries];
+};
+
+class TTranspositionTable {
+public:
+    explicit TTranspositionTable(size_t megabytes = 16);
+
+    ~TTranspositionTable();
+
+    TTranspositionTable(const TTranspositionTable &) = delete;
+
+    TTranspositionTable &operator=(const TTranspositionTable &) = delete;
+
+    void resize(size_t megabytes);
+
+    bool openShared(const char *name, size_t megabytes, int variant);
+
+    bool isShared() const
+    {
+        return mappedBytes != 0;
+    }
+
+    void clear();
+
+    void newSearch();
+
+    bool probe(uint64_t key, TTEntry &entry) const;
+
+    void store(uint64_t key, int depth, int bound, int score, uint16_t move);
+
+    size_t size() const
+    {
+        return bucketCount * BucketEntries;
+    }
+
+private:
+    void release();
+
+    void *memory;
+    size_t mappedBytes; // size of a shared table's mapping, 0 for a private table
+    TTBucket *buckets;
+    size_t bucketCount; // a power of two
+    std::atomic<uint8_t> age;
+};
+
+#endif // CHECKERS_TT_H
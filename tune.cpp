@@ -0,0 +1,446 @@
+/****************************************************************************
+* Evaluation weight tuner.
+*
+* Fits the evaluation weights to a file of labelled positions, one per
+* line: a FEN followed by the result of the game it came from, 1-0 when
+* Black won, 0-1 when Red won or 1/2-1/2 for a draw (2-0, 0-2 and 1-1 are
+* read the same way). checkers_selfplay --positions writes such files.
+*
+* The expected result of a position is a logistic function of its score,
+* and the tuner lowers the mean squared error between the expected and the
+* actual results. The scale of the logistic function is fitted first, then
+* each weight in turn is moved by a step for as long as that lowers the
+* error, and the step is halved when no weight moves. The weights are
+* written after every pass, so a long run can be stopped at any time.
+*
+* Positions where the side to move has a jump are skipped, as the search
+* never scores those. The score is linear in the weights, so each position
+* is reduced once to its piece counts, held in one array per count. The
+* error is worked out a block of positions at a time on every thread, with
+* a scoring loop simple enough for the compiler to vectorize and the
+* logistic function read from a table, so a pass over millions of
+* positions takes a fraction of a second.
+*
+* As a consistency check only, the positions read are also scored in
+* blocks by the engine's batch evaluation, getScores(), with the starting
+* weights. Those scores aren't used for tuning: the tuner stops if its own
+* scores from the counts differ, so the two can't drift apart.
+*
+* Options:
+*   --threads <count>   Threads working out the error (default: hardware threads)
+*   --weights <path>    Weights to start from (default: built in)
+*   --step <score>      First step size (default 16)
+*   --output <path>     File to write the weights to (default eval.weights)
+*   Other arguments are position files, - for stdin (default stdin)
+****************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "eval.h"
+
+// Positions scored at a time by each thread
+static const int BlockSize = 1024;
+// Largest score magnitude any weights can give
+static const int MaxScore = 12 * MaxEvalWeight;
+// Range searched for the scale of the logistic function
+static const double MinScale = 0.0001;
+static const double MaxScale = 0.05;
+
+/****************************************************************************
+ * The positions, as piece count differences from Black's side. Only the
+ * counts are kept, one array for each.
+ */
+struct TDataset {
+    std::vector<int8_t> men;        // men away from the edge
+    std::vector<int8_t> edgeMen;
+    std::vector<int8_t> kings;
+    std::vector<int8_t> gone;       // 1 when Red has no pieces, -1 when Black has none
+    std::vector<float> results;     // 1 Black won, 0.5 drawn, 0 Red won
+};
+
+struct TTuneOptions {
+    int threads;
+    int step;
+    const char *output;
+};
+
+/****************************************************************************
+ * Read a game result.
+ * @param text
+ * @param result - Set to the result for Black
+ * @return false if the text isn't a result.
+ */
+static bool parseResult(const char *text, float &result)
+{
+    if (strcmp(text, "1-0") == 0 || strcmp(text, "2-0") == 0)
+        result = 1.0f;
+    else if (strcmp(text, "0-1") == 0 || strcmp(text, "0-2") == 0)
+        result = 0.0f;
+    else if (strcmp(text, "1/2-1/2") == 0 || strcmp(text, "1-1") == 0)
+        result = 0.5f;
+    else
+        return false;
+    return true;
+}
+
+/****************************************************************************
+ * Add one position to the dataset.
+ */
+static void addPosition(TDataset &data, const TBoard &board, float result)
+{
+    int count[3] = {};  // men, edge men, kings
+    for (int side = Black; side <= Red; side++) {
+        int sign = (side == Black) ? 1 : -1;
+        uint32_t men = board.pieces[side] & ~board.kings;
+        count[0] += sign * bitCount(men & ~EdgeSquares);
+        count[1] += sign * bitCount(men & EdgeSquares);
+        count[2] += sign * bitCount(board.pieces[side] & board.kings);
+    }
+    data.men.push_back(static_cast<int8_t>(count[0]));
+    data.edgeMen.push_back(static_cast<int8_t>(count[1]));
+    data.kings.push_back(static_cast<int8_t>(count[2]));
+    data.gone.push_back(static_cast<int8_t>(board.pieces[Red] == 0 ? 1 : (board.pieces[Black] == 0 ? -1 : 0)));
+    data.results.push_back(result);
+}
+
+/****************************************************************************
+ * Score of a position of the dataset for Black.
+ */
+static inline int countScore(const TDataset &data, const TEvalWeights &weights, size_t idx)
+{
+    int material = weights.man * data.men[idx] + weights.edgeMan * data.edgeMen[idx] +
+                   weights.king * data.kings[idx];
+    return (data.gone[idx] != 0) ? weights.win * data.gone[idx] : material;
+}
+
+/****************************************************************************
+ * Score the boards last added to the dataset with getScores() and check
+ * that countScore() gives the same scores with the weights in use.
+ * @param data
+ * @param boards - The last boards added, cleared
+ * @return false if a score differs.
+ */
+static bool checkScores(const TDataset &data, std::vector<TBoard> &boards)
+{
+    int sides[BlockSize] = {};  // all Black
+    int scores[BlockSize];
+    int count = static_cast<int>(boards.size());
+    size_t first = data.results.size() - boards.size();
+
+    getScores(boards.data(), sides, scores, count);
+    boards.clear();
+    for (int idx = 0; idx < count; idx++) {
+        if (scores[idx] != countScore(data, evalWeights(), first + idx)) {
+            fprintf(stderr, "Position %llu: piece counts score %d, the evaluation %d\n",
+                    static_cast<unsigned long long>(first + idx + 1), countScore(data, evalWeights(), first + idx),
+                    scores[idx]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/****************************************************************************
+ * Read the labelled positions of one file.
+ * @param file
+ * @param name - File name for messages
+ * @param data - Positions are added to it
+ * @param skipped - Counts the positions skipped for a pending jump
+ * @return false if the piece counts don't score as the evaluation does,
+ *         see checkScores().
+ */
+static bool readPositions(FILE *file, const char *name, TDataset &data, uint64_t &skipped)
+{
+    char line[FenTextSize + 32];
+    TMoveList jumps;
+    std::vector<TBoard> boards;     // added since the last check, for checkScores() only
+
+    for (int lineNo = 1; fgets(line, sizeof(line), file); lineNo++) {
+        char *end = line + strlen(line);
+        while (end > line && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+            *--end = '\0';
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+        char *split = strrchr(line, ' ');
+        TBoard board;
+        int side;
+        float result;
+        if (split)
+            *split++ = '\0';
+        if (!split || !parseResult(split, result) || !parseFen(line, board, side)) {
+            fprintf(stderr, "%s:%d: can't read labelled position, skipping it\n", name, lineNo);
+            continue;
+        }
+        getCaptures(board, side, jumps);
+        if (jumps.size() > 0) {
+            skipped++;
+            continue;
+        }
+        addPosition(data, board, result);
+        boards.push_back(board);
+        if (boards.size() == BlockSize && !checkScores(data, boards))
+            return false;
+    }
+    return boards.empty() || checkScores(data, boards);
+} // readPositions
+
+/****************************************************************************
+ * Tabulate the expected result for Black of every score.
+ * @param scale - Scale of the logistic function
+ * @param expected - Filled, indexed by score + MaxScore
+ */
+static void tabulateExpected(double scale, std::vector<float> &expected)
+{
+    expected.resize(2 * MaxScore + 1);
+    for (int score = -MaxScore; score <= MaxScore; score++)
+        expected[score + MaxScore] = static_cast<float>(1.0 / (1.0 + exp(-scale * score)));
+}
+
+/****************************************************************************
+ * Sum the squared errors of a range of positions.
+ */
+static double sumErrors(const TDataset &data, const TEvalWeights &weights, const std::vector<float> &expected,
+                        size_t begin, size_t end)
+{
+    int scores[BlockSize];
+    double sum = 0;
+
+    for (size_t block = begin; block < end; block += BlockSize) {
+        int count = static_cast<int>(std::min<size_t>(BlockSize, end - block));
+        const int8_t *men = data.men.data() + block;
+        const int8_t *edgeMen = data.edgeMen.data() + block;
+        const int8_t *kings = data.kings.data() + block;
+        const int8_t *gone = data.gone.data() + block;
+        const float *results = data.results.data() + block;
+
+        // No branches or calls, for the vectorizer. The same as countScore().
+        for (int idx = 0; idx < count; idx++) {
+            int material = weights.man * men[idx] + weights.edgeMan * edgeMen[idx] + weights.king * kings[idx];
+            scores[idx] = (gone[idx] != 0) ? weights.win * gone[idx] : material;
+        }
+        float blockSum = 0;
+        for (int idx = 0; idx < count; idx++) {
+            float error = results[idx] - expected[scores[idx] + MaxScore];
+            blockSum += error * error;
+        }
+        sum += blockSum;
+    }
+    return sum;
+} // sumErrors
+
+/****************************************************************************
+ * Mean squared error of the expected results over the dataset, worked out
+ * on several threads.
+ * @param data
+ * @param weights
+ * @param expected - From tabulateExpected()
+ * @param threads
+ * @return
+ */
+static double meanError(const TDataset &data, const TEvalWeights &weights, const std::vector<float> &expected,
+                        int threads)
+{
+    size_t count = data.results.size();
+    // Whole blocks for each thread
+    size_t share = (count / BlockSize / threads + 1) * BlockSize;
+    std::vector<double> sums(threads, 0.0);
+    std::vector<std::thread> helpers;
+
+    for (int id = 1; id < threads; id++) {
+        size_t begin = std::min(count, share * id);
+        size_t end = std::min(count, begin + share);
+        helpers.emplace_back([&, id, begin, end]() {
+            sums[id] = sumErrors(data, weights, expected, begin, end);
+        });
+    }
+    sums[0] = sumErrors(data, weights, expected, 0, std::min(count, share));
+    for (std::thread &helper : helpers)
+        helper.join();
+
+    double total = 0;
+    for (double sum : sums)
+        total += sum;
+    return count ? total / count : 0.0;
+} // meanError
+
+/****************************************************************************
+ * Find the scale of the logistic function that fits the weights best, by
+ * golden section search.
+ * @return The scale
+ */
+static double fitScale(const TDataset &data, const TEvalWeights &weights, int threads)
+{
+    const double ratio = (sqrt(5.0) - 1) / 2;
+    std::vector<float> expected;
+    double low = MinScale;
+    double high = MaxScale;
+
+    auto errorAt = [&](double scale) {
+        tabulateExpected(scale, expected);
+        return meanError(data, weights, expected, threads);
+    };
+    double a = high - ratio * (high - low);
+    double b = low + ratio * (high - low);
+    double errorA = errorAt(a);
+    double errorB = errorAt(b);
+    while (high - low > MinScale / 100) {
+        if (errorA < errorB) {
+            high = b;
+            b = a;
+            errorB = errorA;
+            a = high - ratio * (high - low);
+            errorA = errorAt(a);
+        } else {
+            low = a;
+            a = b;
+            errorA = errorB;
+            b = low + ratio * (high - low);
+            errorB = errorAt(b);
+        }
+    }
+    return (low + high) / 2;
+} // fitScale
+
+static void printWeights(const char *fields, const TEvalWeights &weights, double error)
+{
+    printf("{%s,\"error\":%.8f,\"man\":%d,\"edge_man\":%d,\"king\":%d,\"win\":%d}\n", fields, error,
+           weights.man, weights.edgeMan, weights.king, weights.win);
+    fflush(stdout);
+}
+
+/****************************************************************************
+ * Tune the weights by local search, writing them after each pass.
+ * @param data
+ * @param weights - Starting weights, set to the tuned weights
+ * @param options
+ * @return false if the weights couldn't be written.
+ */
+static bool tune(const TDataset &data, TEvalWeights &weights, const TTuneOptions &options)
+{
+    int TEvalWeights::*const tuned[] = {&TEvalWeights::man, &TEvalWeights::edgeMan, &TEvalWeights::king,
+                                        &TEvalWeights::win};
+    std::vector<float> expected;
+    char fields[64];
+
+    double scale = fitScale(data, weights, options.threads);
+    tabulateExpected(scale, expected);
+    double best = meanError(data, weights, expected, options.threads);
+    snprintf(fields, sizeof(fields), "\"pass\":0,\"scale\":%.6f", scale);
+    printWeights(fields, weights, best);
+
+    int step = options.step;
+    for (int pass = 1; step >= 1; pass++) {
+        bool moved = false;
+        for (int TEvalWeights::*weight : tuned) {
+            for (int dir = 1; dir >= -1; dir -= 2) {
+                // Keep going while the error falls
+                for (;;) {
+                    TEvalWeights trial = weights;
+                    trial.*weight += dir * step;
+                    if (trial.*weight < 1 || trial.*weight > MaxEvalWeight)
+                        break;
+                    double error = meanError(data, trial, expected, options.threads);
+                    if (error >= best)
+                        break;
+                    best = error;
+                    weights = trial;
+                    moved = true;
+                }
+            }
+        }
+        snprintf(fields, sizeof(fields), "\"pass\":%d,\"step\":%d", pass, step);
+        printWeights(fields, weights, best);
+        if (!writeEvalWeights(options.output, weights))
+            return false;
+        if (!moved)
+            step /= 2;
+    }
+    return true;
+} // tune
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--threads count] [--weights path] [--step score] [--output path] [file ...]\n",
+            program);
+}
+
+int main(int argc, char *argv[])
+{
+    TTuneOptions options = {static_cast<int>(std::thread::hardware_concurrency()), 16, "eval.weights"};
+    TEvalWeights weights = DefaultEvalWeights;
+    const char *start = nullptr;
+    std::vector<const char *> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            inputs.push_back(argv[i]);
+        } else if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--weights") == 0) {
+            start = argv[++i];
+        } else if (strcmp(argv[i], "--step") == 0) {
+            options.step = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0) {
+            options.output = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.threads < 1)
+        options.threads = 1;
+    if (start && !readEvalWeights(start, weights)) {
+        fprintf(stderr, "Can't read evaluation weights %s\n", start);
+        return 1;
+    }
+    if (inputs.empty())
+        inputs.push_back("-");
+    // Boards are made with the weights in use, for checkScores()
+    setEvalWeights(weights);
+
+    auto readStart = std::chrono::steady_clock::now();
+    TDataset data;
+    uint64_t skipped = 0;
+    for (const char *input : inputs) {
+        bool isStdin = strcmp(input, "-") == 0;
+        FILE *file = isStdin ? stdin : fopen(input, "r");
+        if (!file) {
+            perror(input);
+            return 1;
+        }
+        bool read = readPositions(file, isStdin ? "stdin" : input, data, skipped);
+        if (!isStdin)
+            fclose(file);
+        if (!read)
+            return 1;
+    }
+    if (data.results.empty()) {
+        fprintf(stderr, "No quiet positions to tune on\n");
+        return 1;
+    }
+    auto readEnd = std::chrono::steady_clock::now();
+
+    std::vector<float> expected;
+    tabulateExpected(MaxScale / 10, expected);
+    meanError(data, weights, expected, options.threads);
+    auto passEnd = std::chrono::steady_clock::now();
+    printf("{\"positions\":%llu,\"skipped_jumps\":%llu,\"read_ms\":%lld,\"error_ms\":%.3f,\"threads\":%d}\n",
+           static_cast<unsigned long long>(data.results.size()), static_cast<unsigned long long>(skipped),
+           static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(readEnd - readStart).count()),
+           std::chrono::duration<double, std::milli>(passEnd - readEnd).count(), options.threads);
+
+    if (!tune(data, weights, options)) {
+        perror(options.output);
+        return 1;
+    }
+    return 0;
+} // main